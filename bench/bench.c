@@ -0,0 +1,413 @@
+/*
+	Single thread microbenchmarks of pool_slab and the lists against the system malloc.
+
+	Usage: mmbench [csv|json] [ops]
+
+	Every benchmark replays the same pseudo random sequence (fixed seed) on both allocators.
+	It runs twice: once untimed per operation for the throughput, once with a timer around
+	each operation for the latency percentiles (the timer overhead is subtracted).
+*/
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench_util.h"
+#include "ulist.h"
+
+/** Size of the runtime sized pool */
+#define BENCH_POOL_SIZE (64 * 1024 * 1024)
+/** Page size of the runtime sized pool */
+#define BENCH_PAGE_SIZE 4096
+/** Block size of the runtime sized pool */
+#define BENCH_BLOCK_SIZE 16
+/** Number of live buffers of the churn benchmarks */
+#define BENCH_SLOTS 4096
+/** Number of live buffers of the RAW benchmark */
+#define BENCH_RAW_SLOTS 64
+/** Number of nodes of the list benchmark */
+#define BENCH_LIST_N 1024
+/** Default number of operations of a benchmark */
+#define BENCH_OPS 1000000
+
+/** An allocator under test */
+typedef struct
+{
+	const char* name;
+	void* (*alloc)(void* ctx, size_t size);
+	void (*release)(void* ctx, void* ptr);
+	void* ctx;
+} allocator;
+
+/** One step of a benchmark: free the slot if used, else allocate size bytes in it */
+typedef struct
+{
+	unsigned slot;
+	unsigned size;
+} step;
+
+/** Result of a benchmark on an allocator */
+typedef struct
+{
+	const char* bench;
+	const char* alloc;
+	u64 ops;
+	double ops_per_sec;
+	u64 p50;
+	u64 p99;
+	u64 p999;
+} result;
+
+static u64 rng_state;
+
+static void rng_seed(u64 seed)
+{
+	rng_state = seed * 0x9E3779B97F4A7C15ULL + 1;
+}
+
+/* xorshift64*, the same sequence on every platform */
+static u64 rng(void)
+{
+	rng_state ^= rng_state >> 12;
+	rng_state ^= rng_state << 25;
+	rng_state ^= rng_state >> 27;
+	return rng_state * 0x2545F4914F6CDD1DULL;
+}
+
+static void percentiles(u64* lat, u64 n, result* r)
+{
+	qsort(lat, (size_t)n, sizeof(u64), cmp_u64);
+	r->p50 = lat[n / 2];
+	r->p99 = lat[n * 99 / 100];
+	r->p999 = lat[n * 999 / 1000];
+}
+
+static void* sys_alloc(void* ctx, size_t size)
+{
+	(void)ctx;
+	return malloc(size);
+}
+
+static void sys_release(void* ctx, void* ptr)
+{
+	(void)ctx;
+	free(ptr);
+}
+
+static void* slab_alloc(void* ctx, size_t size)
+{
+	return pool_slab_malloc((pool_slab*)ctx, (pool_size)size, NULL);
+}
+
+static void slab_release(void* ctx, void* ptr)
+{
+	pool_slab_free((pool_slab*)ctx, ptr, NULL);
+}
+
+/* Runs the steps on an allocator, lat is NULL for the throughput run */
+static double run_steps(const allocator* a, const step* steps, u64 n, void** slots, unsigned n_slots, u64* lat, u64 overhead)
+{
+	u64 i, t0, t1, start;
+	unsigned j;
+	void* p;
+	memset(slots, 0, n_slots * sizeof(void*));
+	start = now_ns();
+	for (i = 0; i < n; i++)
+	{
+		void** s = slots + steps[i].slot;
+		t0 = lat ? now_ns() : 0;
+		if (*s != NULL)
+		{
+			a->release(a->ctx, *s);
+			*s = NULL;
+		}
+		else
+		{
+			p = a->alloc(a->ctx, steps[i].size);
+			// Touches the buffer like a real user would
+			if (p != NULL)
+				*(volatile char*)p = 1;
+			*s = p;
+		}
+		if (lat)
+		{
+			t1 = now_ns();
+			lat[i] = t1 - t0 > overhead ? t1 - t0 - overhead : 0;
+		}
+	}
+	t1 = now_ns();
+	for (j = 0; j < n_slots; j++)
+	{
+		if (slots[j] != NULL)
+			a->release(a->ctx, slots[j]);
+	}
+	return (double)n * 1e9 / (double)(t1 - start);
+}
+
+static void bench_steps(const char* name, const allocator* allocs, int n_allocs, const step* steps, u64 n, unsigned n_slots, u64* lat, u64 overhead, result* out)
+{
+	int k;
+	void** slots = malloc(n_slots * sizeof(void*));
+	for (k = 0; k < n_allocs; k++)
+	{
+		out[k].bench = name;
+		out[k].alloc = allocs[k].name;
+		out[k].ops = n;
+		// Warm up, then throughput, then latency
+		run_steps(allocs + k, steps, n < 10000 ? n : 10000, slots, n_slots, NULL, 0);
+		out[k].ops_per_sec = run_steps(allocs + k, steps, n, slots, n_slots, NULL, 0);
+		run_steps(allocs + k, steps, n, slots, n_slots, lat, overhead);
+		percentiles(lat, n, out + k);
+	}
+	free(slots);
+}
+
+static void gen_fixed(step* steps, u64 n)
+{
+	u64 i;
+	rng_seed(1);
+	for (i = 0; i < n; i++)
+	{
+		steps[i].slot = (unsigned)(rng() % BENCH_SLOTS);
+		steps[i].size = 64;
+	}
+}
+
+static void gen_orders(step* steps, u64 n)
+{
+	u64 i;
+	unsigned order, max_order = 0;
+	while ((BENCH_BLOCK_SIZE << (max_order + 1)) <= BENCH_PAGE_SIZE)
+		max_order++;
+	rng_seed(2);
+	for (i = 0; i < n; i++)
+	{
+		// Uniform over the buddy orders, then uniform inside the order
+		order = (unsigned)(rng() % (max_order + 1));
+		steps[i].slot = (unsigned)(rng() % BENCH_SLOTS);
+		steps[i].size = (BENCH_BLOCK_SIZE << order) / 2 + 1 + (unsigned)(rng() % ((BENCH_BLOCK_SIZE << order) / 2));
+	}
+}
+
+static void gen_raw(step* steps, u64 n)
+{
+	u64 i;
+	rng_seed(3);
+	for (i = 0; i < n; i++)
+	{
+		steps[i].slot = (unsigned)(rng() % BENCH_RAW_SLOTS);
+		steps[i].size = BENCH_PAGE_SIZE + 1 + (unsigned)(rng() % (16 * BENCH_PAGE_SIZE));
+	}
+}
+
+/** The lists of the list benchmark */
+enum { LIST_POOL, LIST_UNROLLED, LIST_SYS };
+
+/* A malloc based doubly linked list with the same layout as pool_list */
+typedef struct sys_node
+{
+	void* data;
+	struct sys_node* next;
+	struct sys_node* prev;
+} sys_node;
+
+static volatile u64 list_sink;
+
+static pool_u8 list_visit(const pool_list_node* n, void* data)
+{
+	*(u64*)data += (u64)(size_t)n->data;
+	return 1;
+}
+
+static pool_u8 ulist_visit(void* item, void* data)
+{
+	*(u64*)data += (u64)(size_t)item;
+	return 1;
+}
+
+/* Push back, iterate, then remove from the front, n times over BENCH_LIST_N nodes */
+static double run_list(int kind, pool_list* list, pool_ulist* ulist, u64 rounds, u64* lat, u64 overhead)
+{
+	u64 r, i, t0 = 0, t1, start, op = 0, sum = 0;
+	sys_node* head = NULL;
+	sys_node* tail = NULL;
+	sys_node* node;
+	start = now_ns();
+	for (r = 0; r < rounds; r++)
+	{
+		// Push
+		for (i = 0; i < BENCH_LIST_N; i++)
+		{
+			if (lat)
+				t0 = now_ns();
+			if (kind == LIST_SYS)
+			{
+				node = malloc(sizeof(sys_node));
+				node->data = (void*)(size_t)i;
+				node->next = NULL;
+				node->prev = tail;
+				if (tail)
+					tail->next = node;
+				else
+					head = node;
+				tail = node;
+			}
+			else if (kind == LIST_UNROLLED)
+				pool_ulist_push_back(ulist, (void*)(size_t)i, NULL);
+			else
+				pool_list_push_back(list, (void*)(size_t)i, NULL);
+			if (lat)
+			{
+				t1 = now_ns();
+				lat[op++] = t1 - t0 > overhead ? t1 - t0 - overhead : 0;
+			}
+		}
+		// Iterate (one operation per node)
+		if (lat)
+			t0 = now_ns();
+		if (kind == LIST_SYS)
+		{
+			for (node = head; node; node = node->next)
+				sum += (u64)(size_t)node->data;
+		}
+		else if (kind == LIST_UNROLLED)
+			pool_ulist_iterate(ulist, ulist_visit, &sum, NULL);
+		else
+			pool_list_iterate(list, list_visit, &sum, NULL);
+		if (lat)
+		{
+			t1 = now_ns();
+			for (i = 0; i < BENCH_LIST_N; i++)
+				lat[op++] = (t1 - t0 > overhead ? t1 - t0 - overhead : 0) / BENCH_LIST_N;
+		}
+		// Remove
+		for (i = 0; i < BENCH_LIST_N; i++)
+		{
+			if (lat)
+				t0 = now_ns();
+			if (kind == LIST_SYS)
+			{
+				node = head;
+				head = node->next;
+				if (head)
+					head->prev = NULL;
+				else
+					tail = NULL;
+				free(node);
+			}
+			else if (kind == LIST_UNROLLED)
+				pool_ulist_remove(ulist, 0, NULL);
+			else
+				pool_list_remove(list, list->head, NULL);
+			if (lat)
+			{
+				t1 = now_ns();
+				lat[op++] = t1 - t0 > overhead ? t1 - t0 - overhead : 0;
+			}
+		}
+	}
+	t1 = now_ns();
+	list_sink = sum;
+	return (double)(rounds * 3 * BENCH_LIST_N) * 1e9 / (double)(t1 - start);
+}
+
+/* The list on the pool, on a node cache, the unrolled list, then the malloc list */
+static void bench_list(pool_t* pool, pool_cache* cache, u64 n, u64* lat, u64 overhead, result* out)
+{
+	static const char* names[4] = { "pool_slab", "pool_cache", "pool_ulist", "malloc" };
+	static const int kinds[4] = { LIST_POOL, LIST_POOL, LIST_UNROLLED, LIST_SYS };
+	pool_list list;
+	pool_ulist ulist;
+	u64 rounds = n / (3 * BENCH_LIST_N);
+	int i;
+	if (rounds == 0)
+		rounds = 1;
+	pool_ulist_init(&ulist, pool, NULL);
+	for (i = 0; i < 4; i++)
+	{
+		if (i == 1)
+			pool_list_init_cache(&list, cache, NULL);
+		else
+			pool_list_init(&list, pool, NULL);
+		out[i].bench = "list";
+		out[i].alloc = names[i];
+		out[i].ops = rounds * 3 * BENCH_LIST_N;
+		run_list(kinds[i], &list, &ulist, 1, NULL, 0);
+		out[i].ops_per_sec = run_list(kinds[i], &list, &ulist, rounds, NULL, 0);
+		run_list(kinds[i], &list, &ulist, rounds, lat, overhead);
+		percentiles(lat, out[i].ops, out + i);
+	}
+}
+
+static void print_results(const result* r, int n, int json)
+{
+	int i;
+	if (json)
+		printf("[\n");
+	else
+		printf("bench,allocator,ops,ops_per_sec,p50_ns,p99_ns,p999_ns\n");
+	for (i = 0; i < n; i++)
+	{
+		if (json)
+			printf("  {\"bench\": \"%s\", \"allocator\": \"%s\", \"ops\": %llu, \"ops_per_sec\": %.0f, \"p50_ns\": %llu, \"p99_ns\": %llu, \"p999_ns\": %llu}%s\n",
+				r[i].bench, r[i].alloc, r[i].ops, r[i].ops_per_sec, r[i].p50, r[i].p99, r[i].p999, i + 1 < n ? "," : "");
+		else
+			printf("%s,%s,%llu,%.0f,%llu,%llu,%llu\n", r[i].bench, r[i].alloc, r[i].ops, r[i].ops_per_sec, r[i].p50, r[i].p99, r[i].p999);
+	}
+	if (json)
+		printf("]\n");
+}
+
+int main(int argc, char** argv)
+{
+	int json = argc > 1 && strcmp(argv[1], "json") == 0;
+	u64 n = argc > 2 ? strtoull(argv[2], NULL, 10) : BENCH_OPS;
+	u64 overhead = timer_overhead();
+	step* steps = malloc((size_t)n * sizeof(step));
+	u64* lat = malloc((size_t)(n + 3 * BENCH_LIST_N) * sizeof(u64));
+	void* mem = malloc(BENCH_POOL_SIZE);
+	static pool_t list_pool;
+	static char list_mem[POOL_MAX_SIZE];
+	pool_cache list_cache;
+	pool_err err;
+	pool_slab* slab;
+	allocator allocs[2];
+	result results[10];
+
+	if (n == 0 || steps == NULL || lat == NULL || mem == NULL)
+	{
+		fprintf(stderr, "usage: %s [csv|json] [ops]\n", argv[0]);
+		return 1;
+	}
+	slab = pool_slab_create(mem, BENCH_POOL_SIZE, BENCH_PAGE_SIZE, BENCH_BLOCK_SIZE, &err);
+	pool_init(&list_pool, list_mem, &err);
+	if (err == POOL_ERR_OK)
+		pool_cache_init(&list_cache, &list_pool.slab, sizeof(pool_list_node), &err);
+	if (slab == NULL || err != POOL_ERR_OK)
+	{
+		fprintf(stderr, "pool init failed (%d)\n", err);
+		return 1;
+	}
+	allocs[0].name = "pool_slab";
+	allocs[0].alloc = slab_alloc;
+	allocs[0].release = slab_release;
+	allocs[0].ctx = slab;
+	allocs[1].name = "malloc";
+	allocs[1].alloc = sys_alloc;
+	allocs[1].release = sys_release;
+	allocs[1].ctx = NULL;
+
+	gen_fixed(steps, n);
+	bench_steps("fixed_churn", allocs, 2, steps, n, BENCH_SLOTS, lat, overhead, results);
+	gen_orders(steps, n);
+	bench_steps("random_orders", allocs, 2, steps, n, BENCH_SLOTS, lat, overhead, results + 2);
+	gen_raw(steps, n);
+	bench_steps("raw_large", allocs, 2, steps, n, BENCH_RAW_SLOTS, lat, overhead, results + 4);
+	bench_list(&list_pool, &list_cache, n, lat, overhead, results + 6);
+
+	print_results(results, 10, json);
+	free(mem);
+	free(lat);
+	free(steps);
+	return 0;
+}
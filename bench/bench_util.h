@@ -0,0 +1,41 @@
+/*
+	Timer helpers shared by the benchmark programs, define _POSIX_C_SOURCE before including it.
+*/
+#ifndef BENCH_UTIL_H_INCLUDED
+#define BENCH_UTIL_H_INCLUDED
+
+#include <stdlib.h>
+#include <time.h>
+
+typedef unsigned long long u64;
+
+static u64 now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u64)ts.tv_sec * 1000000000ULL + (u64)ts.tv_nsec;
+}
+
+static int cmp_u64(const void* a, const void* b)
+{
+	u64 x = *(const u64*)a;
+	u64 y = *(const u64*)b;
+	return x < y ? -1 : x > y;
+}
+
+/* Median cost of reading the timer twice */
+static u64 timer_overhead(void)
+{
+	u64 samples[1001];
+	u64 t;
+	int i;
+	for (i = 0; i < 1001; i++)
+	{
+		t = now_ns();
+		samples[i] = now_ns() - t;
+	}
+	qsort(samples, 1001, sizeof(u64), cmp_u64);
+	return samples[500];
+}
+
+#endif
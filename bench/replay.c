@@ -0,0 +1,720 @@
+/*
+	Replays a recorded allocation trace on pool_slab, pool_buddy and the system malloc.
+
+	Usage: mmreplay [-f csv|json] [-s pool_size] [-p page_size] [-b block_size] trace
+
+	The trace is a text file, one operation per line (# starts a comment):
+		a <id> <size>    allocates size bytes for the object id
+		r <id> <size>    reallocates the object id (allocates it if it is not live)
+		f <id>           frees the object id
+	or a binary trace written by pool_trace_dump, whose pointers are turned into object ids.
+	The failed operations of a binary trace are skipped. A realloc that moved its buffer is
+	followed by the free of its old pointer, the two are replayed as one realloc.
+
+	Every allocator replays the trace twice: once untimed per operation for the total time,
+	once with a timer around each operation for the latency percentiles (the timer overhead
+	is subtracted), the peak footprint and the first allocation that failed.
+*/
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench_util.h"
+#include "pool_slab.h"
+
+/** Default size of the pools */
+#define REPLAY_POOL_SIZE (64 * 1024 * 1024)
+/** Default page size of the slab pool */
+#define REPLAY_PAGE_SIZE 4096
+/** Default block size of the pools */
+#define REPLAY_BLOCK_SIZE 16
+
+/** Kinds of operations */
+enum
+{
+	OP_ALLOC,
+	OP_REALLOC,
+	OP_FREE
+};
+
+/** One operation of the trace, id is the dense index of the object */
+typedef struct
+{
+	unsigned char kind;
+	unsigned id;
+	u64 size;
+} op;
+
+/** The trace */
+typedef struct
+{
+	op* ops;
+	u64 n;
+	u64 cap;
+	/** Number of objects */
+	unsigned ids;
+	/** Frees and reallocs of objects the trace did not allocate, allocations over objects it did not free (the ring overwrote them) */
+	u64 unmatched;
+} trace;
+
+/** Maps the ids or pointers of the trace to dense object indices (open addressing) */
+typedef struct
+{
+	u64* keys;
+	unsigned* vals;
+	unsigned char* used;
+	u64 mask;
+	u64 n;
+} id_map;
+
+/** An allocator under test */
+typedef struct
+{
+	const char* name;
+	/** Makes the allocator empty, returns 0 on failure */
+	int (*reset)(void* ctx);
+	void* (*alloc)(void* ctx, size_t size);
+	void* (*resize)(void* ctx, void* ptr, size_t old_size, size_t size);
+	void (*release)(void* ctx, void* ptr);
+	/** Bytes taken from the memory, NULL if unknown */
+	u64 (*footprint)(void* ctx);
+	void* ctx;
+} allocator;
+
+/** Result of a replay on an allocator */
+typedef struct
+{
+	const char* alloc;
+	u64 ops;
+	double total_ms;
+	u64 p50;
+	u64 p99;
+	u64 p999;
+	u64 peak_live;
+	u64 peak_footprint;
+	int has_footprint;
+	u64 failures;
+	long long first_oom;
+} result;
+
+/** The slab pool and its memory */
+typedef struct
+{
+	void* mem;
+	size_t size;
+	pool_size page_size;
+	pool_size block_size;
+	pool_slab* slab;
+} slab_ctx;
+
+/** The buddy and its memory */
+typedef struct
+{
+	void* mem;
+	void* meta;
+	size_t size;
+	pool_size block_size;
+	pool_buddy buddy;
+} buddy_ctx;
+
+static u64 hash_u64(u64 k)
+{
+	k ^= k >> 33;
+	k *= 0xff51afd7ed558ccdULL;
+	k ^= k >> 33;
+	return k;
+}
+
+static void map_init(id_map* m)
+{
+	m->mask = 1023;
+	m->n = 0;
+	m->keys = malloc((size_t)(m->mask + 1) * sizeof(u64));
+	m->vals = malloc((size_t)(m->mask + 1) * sizeof(unsigned));
+	m->used = calloc((size_t)(m->mask + 1), 1);
+}
+
+static void map_destroy(id_map* m)
+{
+	free(m->keys);
+	free(m->vals);
+	free(m->used);
+}
+
+/* Slot of a key, the first free slot if the key is not in the map */
+static u64 map_slot(const id_map* m, u64 key)
+{
+	u64 i = hash_u64(key) & m->mask;
+	while (m->used[i] && m->keys[i] != key)
+		i = (i + 1) & m->mask;
+	return i;
+}
+
+static void map_put(id_map* m, u64 key, unsigned val);
+
+static void map_grow(id_map* m)
+{
+	id_map old = *m;
+	u64 i;
+	m->mask = m->mask * 2 + 1;
+	m->n = 0;
+	m->keys = malloc((size_t)(m->mask + 1) * sizeof(u64));
+	m->vals = malloc((size_t)(m->mask + 1) * sizeof(unsigned));
+	m->used = calloc((size_t)(m->mask + 1), 1);
+	for (i = 0; i <= old.mask; i++)
+	{
+		if (old.used[i])
+			map_put(m, old.keys[i], old.vals[i]);
+	}
+	map_destroy(&old);
+}
+
+static void map_put(id_map* m, u64 key, unsigned val)
+{
+	u64 i;
+	if ((m->n + 1) * 2 > m->mask + 1)
+		map_grow(m);
+	i = map_slot(m, key);
+	if (!m->used[i])
+		m->n++;
+	m->used[i] = 1;
+	m->keys[i] = key;
+	m->vals[i] = val;
+}
+
+/* Removes a key, returns 0 if it is not in the map */
+static int map_take(id_map* m, u64 key, unsigned* val)
+{
+	u64 i = map_slot(m, key);
+	u64 j, k;
+	if (!m->used[i])
+		return 0;
+	*val = m->vals[i];
+	m->used[i] = 0;
+	m->n--;
+	// Moves back the following keys of the cluster so the lookups still find them
+	for (j = (i + 1) & m->mask; m->used[j]; j = (j + 1) & m->mask)
+	{
+		k = hash_u64(m->keys[j]) & m->mask;
+		if ((j > i && (k <= i || k > j)) || (j < i && k <= i && k > j))
+		{
+			m->keys[i] = m->keys[j];
+			m->vals[i] = m->vals[j];
+			m->used[i] = 1;
+			m->used[j] = 0;
+			i = j;
+		}
+	}
+	return 1;
+}
+
+static int map_get(const id_map* m, u64 key, unsigned* val)
+{
+	u64 i = map_slot(m, key);
+	if (!m->used[i])
+		return 0;
+	*val = m->vals[i];
+	return 1;
+}
+
+static void push_op(trace* t, unsigned char kind, unsigned id, u64 size)
+{
+	if (t->n == t->cap)
+	{
+		t->cap = t->cap ? t->cap * 2 : 4096;
+		t->ops = realloc(t->ops, (size_t)t->cap * sizeof(op));
+		if (t->ops == NULL)
+		{
+			fprintf(stderr, "out of memory\n");
+			exit(1);
+		}
+	}
+	t->ops[t->n].kind = kind;
+	t->ops[t->n].id = id;
+	t->ops[t->n].size = size;
+	t->n++;
+}
+
+/* Adds an operation on the key (an id or a pointer), new objects get the next index */
+static void add_op(trace* t, id_map* m, unsigned char kind, u64 key, u64 size)
+{
+	unsigned id;
+	if (kind == OP_FREE)
+	{
+		if (map_take(m, key, &id))
+			push_op(t, OP_FREE, id, 0);
+		else
+			t->unmatched++;
+		return;
+	}
+	if (kind == OP_REALLOC && map_get(m, key, &id))
+	{
+		push_op(t, OP_REALLOC, id, size);
+		return;
+	}
+	if (kind == OP_REALLOC)
+		t->unmatched++;
+	// The key was reused, the object it held was freed out of the trace
+	if (map_take(m, key, &id))
+	{
+		push_op(t, OP_FREE, id, 0);
+		t->unmatched++;
+	}
+	id = t->ids++;
+	map_put(m, key, id);
+	push_op(t, OP_ALLOC, id, size);
+}
+
+/* Adds a realloc that moved the object of old_key to new_key */
+static void add_move(trace* t, id_map* m, u64 old_key, u64 new_key, u64 size)
+{
+	unsigned id, stale;
+	if (!map_take(m, old_key, &id))
+	{
+		t->unmatched++;
+		add_op(t, m, OP_ALLOC, new_key, size);
+		return;
+	}
+	if (map_take(m, new_key, &stale))
+	{
+		push_op(t, OP_FREE, stale, 0);
+		t->unmatched++;
+	}
+	map_put(m, new_key, id);
+	push_op(t, OP_REALLOC, id, size);
+}
+
+static u64 get_le(const unsigned char* buf, int n)
+{
+	u64 v = 0;
+	while (n-- > 0)
+		v = v << 8 | buf[n];
+	return v;
+}
+
+/* Reads a trace written by pool_trace_dump, the header is already in buf */
+static int read_binary(FILE* f, const unsigned char* buf, trace* t, id_map* m)
+{
+	unsigned char ev[POOL_TRACE_EVENT_SIZE];
+	u64 count = get_le(buf + 16, 8);
+	u64 i, time, ptr, size;
+	u64 re_time = 0, re_ptr = 0, re_size = 0;
+	int re_pending = 0, ok;
+	unsigned id;
+	unsigned char kind;
+	if (get_le(buf + 4, 2) != POOL_TRACE_VERSION || get_le(buf + 6, 2) != POOL_TRACE_EVENT_SIZE)
+	{
+		fprintf(stderr, "unsupported trace version\n");
+		return 0;
+	}
+	for (i = 0; i < count; i++)
+	{
+		if (fread(ev, 1, sizeof(ev), f) != sizeof(ev))
+		{
+			fprintf(stderr, "truncated trace\n");
+			return 0;
+		}
+		time = get_le(ev, 8);
+		ptr = get_le(ev + 8, 8);
+		size = get_le(ev + 16, 8);
+		kind = ev[32];
+		// Failed operations did not change the pool
+		ok = ev[34] == POOL_ERR_OK && (ptr != 0 || kind == POOL_TRACE_FREE);
+		// A free with the time of the previous realloc is its old buffer (without a clock, only if the realloc moved)
+		if (re_pending)
+		{
+			re_pending = 0;
+			if (ok && kind == POOL_TRACE_FREE && time == re_time && ptr != re_ptr && (time != 0 || !map_get(m, re_ptr, &id)))
+			{
+				add_move(t, m, ptr, re_ptr, re_size);
+				continue;
+			}
+			add_op(t, m, OP_REALLOC, re_ptr, re_size);
+		}
+		if (!ok)
+			continue;
+		if (kind == POOL_TRACE_MALLOC)
+			add_op(t, m, OP_ALLOC, ptr, size);
+		else if (kind == POOL_TRACE_REALLOC)
+		{
+			re_pending = 1;
+			re_time = time;
+			re_ptr = ptr;
+			re_size = size;
+		}
+		else if (kind == POOL_TRACE_FREE)
+			add_op(t, m, OP_FREE, ptr, 0);
+	}
+	if (re_pending)
+		add_op(t, m, OP_REALLOC, re_ptr, re_size);
+	return 1;
+}
+
+/* Reads a text trace from the start */
+static int read_text(FILE* f, trace* t, id_map* m)
+{
+	char line[256];
+	char c;
+	unsigned long long id, size;
+	u64 n = 0;
+	rewind(f);
+	while (fgets(line, sizeof(line), f) != NULL)
+	{
+		n++;
+		if (sscanf(line, " %c", &c) != 1 || c == '#')
+			continue;
+		if ((c == 'a' || c == 'r') && sscanf(line, " %c %llu %llu", &c, &id, &size) == 3 && size != 0)
+			add_op(t, m, c == 'a' ? OP_ALLOC : OP_REALLOC, id, size);
+		else if (c == 'f' && sscanf(line, " %c %llu", &c, &id) == 2)
+			add_op(t, m, OP_FREE, id, 0);
+		else
+		{
+			fprintf(stderr, "line %llu: bad operation\n", n);
+			return 0;
+		}
+	}
+	return 1;
+}
+
+static int read_trace(const char* path, trace* t)
+{
+	unsigned char buf[POOL_TRACE_HEADER_SIZE];
+	id_map m;
+	int ok;
+	FILE* f = fopen(path, "rb");
+	if (f == NULL)
+	{
+		fprintf(stderr, "cannot open %s\n", path);
+		return 0;
+	}
+	memset(t, 0, sizeof(*t));
+	map_init(&m);
+	if (fread(buf, 1, sizeof(buf), f) == sizeof(buf) && get_le(buf, 4) == POOL_TRACE_MAGIC)
+		ok = read_binary(f, buf, t, &m);
+	else
+		ok = read_text(f, t, &m);
+	map_destroy(&m);
+	fclose(f);
+	return ok;
+}
+
+static int slab_reset(void* ctx)
+{
+	slab_ctx* c = ctx;
+	c->slab = pool_slab_create(c->mem, (pool_size)c->size, c->page_size, c->block_size, NULL);
+	return c->slab != NULL;
+}
+
+static void* slab_alloc(void* ctx, size_t size)
+{
+	return pool_slab_malloc(((slab_ctx*)ctx)->slab, (pool_size)size, NULL);
+}
+
+static void* slab_resize(void* ctx, void* ptr, size_t old_size, size_t size)
+{
+	(void)old_size;
+	return pool_slab_realloc(((slab_ctx*)ctx)->slab, ptr, (pool_size)size, NULL);
+}
+
+static void slab_release(void* ctx, void* ptr)
+{
+	pool_slab_free(((slab_ctx*)ctx)->slab, ptr, NULL);
+}
+
+/* The pages that are not empty */
+static u64 slab_footprint(void* ctx)
+{
+	pool_slab_stats stats;
+	pool_slab_stat(((slab_ctx*)ctx)->slab, &stats, NULL);
+	return (u64)(stats.n_pages - stats.n_pages_empty) * ((slab_ctx*)ctx)->page_size;
+}
+
+static int buddy_reset(void* ctx)
+{
+	buddy_ctx* c = ctx;
+	pool_err err;
+	pool_buddy_init(&c->buddy, c->mem, (pool_size)c->size, c->block_size, c->meta, &err);
+	return err == POOL_ERR_OK;
+}
+
+static void* buddy_alloc(void* ctx, size_t size)
+{
+	return pool_buddy_malloc(&((buddy_ctx*)ctx)->buddy, (pool_size)size, NULL);
+}
+
+static void buddy_release(void* ctx, void* ptr)
+{
+	pool_buddy_free(&((buddy_ctx*)ctx)->buddy, ptr, NULL);
+}
+
+static void* buddy_resize(void* ctx, void* ptr, size_t old_size, size_t size)
+{
+	pool_buddy* b = &((buddy_ctx*)ctx)->buddy;
+	void* ret;
+	if (ptr == NULL)
+		return buddy_alloc(ctx, size);
+	if (pool_buddy_resize(b, ptr, (pool_size)size, NULL))
+		return ptr;
+	ret = pool_buddy_malloc(b, (pool_size)size, NULL);
+	if (ret == NULL)
+		return NULL;
+	memcpy(ret, ptr, old_size < size ? old_size : size);
+	pool_buddy_free(b, ptr, NULL);
+	return ret;
+}
+
+static u64 buddy_footprint(void* ctx)
+{
+	return pool_buddy_size(&((buddy_ctx*)ctx)->buddy, NULL);
+}
+
+static int sys_reset(void* ctx)
+{
+	(void)ctx;
+	return 1;
+}
+
+static void* sys_alloc(void* ctx, size_t size)
+{
+	(void)ctx;
+	return malloc(size);
+}
+
+static void* sys_resize(void* ctx, void* ptr, size_t old_size, size_t size)
+{
+	(void)ctx;
+	(void)old_size;
+	return realloc(ptr, size);
+}
+
+static void sys_release(void* ctx, void* ptr)
+{
+	(void)ctx;
+	free(ptr);
+}
+
+/* Replays the trace, lat is NULL for the untimed run, returns the time in ns */
+static u64 replay(const allocator* a, const trace* t, void** ptrs, u64* sizes, u64* lat, u64 overhead, result* r)
+{
+	u64 i, t0, t1, fp, start, live = 0;
+	unsigned j;
+	const op* o;
+	void* p;
+	memset(ptrs, 0, t->ids * sizeof(void*));
+	memset(sizes, 0, t->ids * sizeof(u64));
+	start = now_ns();
+	for (i = 0; i < t->n; i++)
+	{
+		o = t->ops + i;
+		t0 = lat ? now_ns() : 0;
+		if (o->kind == OP_FREE)
+		{
+			if (ptrs[o->id] != NULL)
+				a->release(a->ctx, ptrs[o->id]);
+			p = NULL;
+		}
+		else
+		{
+			p = o->kind == OP_ALLOC ? a->alloc(a->ctx, (size_t)o->size) : a->resize(a->ctx, ptrs[o->id], (size_t)sizes[o->id], (size_t)o->size);
+			// Touches the buffer like a real user would
+			if (p != NULL)
+				*(volatile char*)p = 1;
+		}
+		if (lat != NULL)
+		{
+			t1 = now_ns();
+			lat[i] = t1 - t0 > overhead ? t1 - t0 - overhead : 0;
+		}
+		// A failed realloc keeps the old buffer, a failed alloc leaves the object dead
+		if (o->kind != OP_FREE && p == NULL)
+		{
+			if (lat != NULL && r->first_oom < 0)
+				r->first_oom = (long long)i;
+			r->failures += lat != NULL;
+			continue;
+		}
+		live -= sizes[o->id];
+		ptrs[o->id] = p;
+		sizes[o->id] = p != NULL ? o->size : 0;
+		live += sizes[o->id];
+		if (lat == NULL)
+			continue;
+		if (live > r->peak_live)
+			r->peak_live = live;
+		if (a->footprint != NULL && (fp = a->footprint(a->ctx)) > r->peak_footprint)
+			r->peak_footprint = fp;
+	}
+	t1 = now_ns();
+	for (j = 0; j < t->ids; j++)
+	{
+		if (ptrs[j] != NULL)
+			a->release(a->ctx, ptrs[j]);
+	}
+	return t1 - start;
+}
+
+static int run(const allocator* a, const trace* t, void** ptrs, u64* sizes, u64* lat, u64 overhead, result* r)
+{
+	memset(r, 0, sizeof(*r));
+	r->alloc = a->name;
+	r->ops = t->n;
+	r->first_oom = -1;
+	r->has_footprint = a->footprint != NULL;
+	if (!a->reset(a->ctx))
+		return 0;
+	r->total_ms = (double)replay(a, t, ptrs, sizes, NULL, 0, r) / 1e6;
+	if (!a->reset(a->ctx))
+		return 0;
+	replay(a, t, ptrs, sizes, lat, overhead, r);
+	qsort(lat, (size_t)t->n, sizeof(u64), cmp_u64);
+	r->p50 = lat[t->n / 2];
+	r->p99 = lat[t->n * 99 / 100];
+	r->p999 = lat[t->n * 999 / 1000];
+	return 1;
+}
+
+static void print_results(const result* r, int n, const trace* t, int json)
+{
+	int i;
+	char fp[32], oom[32];
+	if (json)
+		printf("{\"ops\": %llu, \"objects\": %u, \"unmatched\": %llu, \"results\": [\n", t->n, t->ids, t->unmatched);
+	else
+		printf("allocator,ops,total_ms,p50_ns,p99_ns,p999_ns,peak_live,peak_footprint,failures,first_oom\n");
+	for (i = 0; i < n; i++)
+	{
+		if (r[i].has_footprint)
+			sprintf(fp, "%llu", r[i].peak_footprint);
+		else
+			strcpy(fp, json ? "null" : "");
+		if (r[i].first_oom >= 0)
+			sprintf(oom, "%lld", r[i].first_oom);
+		else
+			strcpy(oom, json ? "null" : "");
+		if (json)
+			printf("  {\"allocator\": \"%s\", \"ops\": %llu, \"total_ms\": %.3f, \"p50_ns\": %llu, \"p99_ns\": %llu, \"p999_ns\": %llu, \"peak_live\": %llu, \"peak_footprint\": %s, \"failures\": %llu, \"first_oom\": %s}%s\n",
+				r[i].alloc, r[i].ops, r[i].total_ms, r[i].p50, r[i].p99, r[i].p999, r[i].peak_live, fp, r[i].failures, oom, i + 1 < n ? "," : "");
+		else
+			printf("%s,%llu,%.3f,%llu,%llu,%llu,%llu,%s,%llu,%s\n",
+				r[i].alloc, r[i].ops, r[i].total_ms, r[i].p50, r[i].p99, r[i].p999, r[i].peak_live, fp, r[i].failures, oom);
+	}
+	if (json)
+		printf("]}\n");
+}
+
+static void usage(const char* name)
+{
+	fprintf(stderr, "usage: %s [-f csv|json] [-s pool_size] [-p page_size] [-b block_size] trace\n", name);
+}
+
+int main(int argc, char** argv)
+{
+	int json = 0;
+	int i, n = 0;
+	const char* path = NULL;
+	size_t size = REPLAY_POOL_SIZE;
+	pool_size page_size = REPLAY_PAGE_SIZE;
+	pool_size block_size = REPLAY_BLOCK_SIZE;
+	static slab_ctx slab;
+	static buddy_ctx buddy;
+	allocator allocs[3];
+	result results[3];
+	trace t;
+	void** ptrs;
+	u64* sizes;
+	u64* lat;
+	u64 overhead;
+
+	for (i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-f") == 0 && i + 1 < argc)
+			json = strcmp(argv[++i], "json") == 0;
+		else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+			size = (size_t)strtoull(argv[++i], NULL, 0);
+		else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc)
+			page_size = (pool_size)strtoull(argv[++i], NULL, 0);
+		else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc)
+			block_size = (pool_size)strtoull(argv[++i], NULL, 0);
+		else if (argv[i][0] != '-' && path == NULL)
+			path = argv[i];
+		else
+		{
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if (path == NULL || !POOL_IS_POW2(page_size) || !POOL_IS_POW2(block_size) || block_size > page_size)
+	{
+		usage(argv[0]);
+		return 1;
+	}
+	if (!read_trace(path, &t))
+		return 1;
+	if (t.n == 0)
+	{
+		fprintf(stderr, "empty trace\n");
+		return 1;
+	}
+
+	// The buddy takes the largest power of 2 that fits in the pool size
+	slab.size = size;
+	slab.page_size = page_size;
+	slab.block_size = block_size;
+	slab.mem = malloc(size);
+	for (buddy.size = block_size; buddy.size * 2 <= size; buddy.size *= 2);
+	buddy.block_size = block_size;
+	buddy.mem = malloc(buddy.size);
+	buddy.meta = malloc(POOL_BUDDY_META_SIZE(buddy.size, block_size));
+	ptrs = malloc((t.ids + 1) * sizeof(void*));
+	sizes = malloc((t.ids + 1) * sizeof(u64));
+	lat = malloc((size_t)t.n * sizeof(u64));
+	if (slab.mem == NULL || buddy.mem == NULL || buddy.meta == NULL || ptrs == NULL || sizes == NULL || lat == NULL)
+	{
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+
+	allocs[0].name = "pool_slab";
+	allocs[0].reset = slab_reset;
+	allocs[0].alloc = slab_alloc;
+	allocs[0].resize = slab_resize;
+	allocs[0].release = slab_release;
+	allocs[0].footprint = slab_footprint;
+	allocs[0].ctx = &slab;
+	allocs[1].name = "pool_buddy";
+	allocs[1].reset = buddy_reset;
+	allocs[1].alloc = buddy_alloc;
+	allocs[1].resize = buddy_resize;
+	allocs[1].release = buddy_release;
+	allocs[1].footprint = buddy_footprint;
+	allocs[1].ctx = &buddy;
+	allocs[2].name = "malloc";
+	allocs[2].reset = sys_reset;
+	allocs[2].alloc = sys_alloc;
+	allocs[2].resize = sys_resize;
+	allocs[2].release = sys_release;
+	allocs[2].footprint = NULL;
+	allocs[2].ctx = NULL;
+
+	overhead = timer_overhead();
+	for (i = 0; i < 3; i++)
+	{
+		if (run(allocs + i, &t, ptrs, sizes, lat, overhead, results + n))
+			n++;
+		else
+			fprintf(stderr, "%s init failed\n", allocs[i].name);
+	}
+	if (t.unmatched != 0)
+		fprintf(stderr, "%llu operations on objects the trace did not allocate\n", t.unmatched);
+	print_results(results, n, &t, json);
+
+	free(lat);
+	free(sizes);
+	free(ptrs);
+	free(buddy.meta);
+	free(buddy.mem);
+	free(slab.mem);
+	free(t.ops);
+	return 0;
+}
@@ -0,0 +1,141 @@
+#include "ilist.h"
+
+/**
+	@fn void pool_ilist_init(pool_ilist* list, pool_err* err)
+	@brief Initializes the list
+
+	@param[inout] list The list
+	@param[out] err The error
+*/
+POOL_FUNC void pool_ilist_init(pool_ilist* list, pool_err* err)
+{
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(list == NULL, err, POOL_LIST_ERR_INVALID_LIST, );
+
+	list->head = NULL;
+	list->tail = NULL;
+}
+
+/**
+	@fn void pool_ilist_add(pool_ilist* list, pool_ilist_node* node, pool_ilist_node* after, pool_err* err)
+	@brief Adds an item to the list
+
+	@param[inout] list The list
+	@param[inout] node The node of the item to add
+	@param[in] after The node in the list that will be placed before the new node, NULL for the beginning of the list
+	@param[out] err The error
+*/
+POOL_FUNC void pool_ilist_add(pool_ilist* list, pool_ilist_node* node, pool_ilist_node* after, pool_err* err)
+{
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(list == NULL, err, POOL_LIST_ERR_INVALID_LIST, );
+	POOL_SET_ERR_IF(node == NULL, err, POOL_LIST_ERR_INVALID_NODE, );
+
+	node->prev = after;
+	node->next = after != NULL ? after->next : list->head;
+	if(node->prev != NULL)
+		node->prev->next = node;
+	else
+		list->head = node;
+	if(node->next != NULL)
+		node->next->prev = node;
+	else
+		list->tail = node;
+}
+
+/**
+	@fn void pool_ilist_push_back(pool_ilist* list, pool_ilist_node* node, pool_err* err)
+	@brief Adds an item to the end of the list
+
+	@param[inout] list The list
+	@param[inout] node The node of the item to add
+	@param[out] err The error
+*/
+POOL_FUNC void pool_ilist_push_back(pool_ilist* list, pool_ilist_node* node, pool_err* err)
+{
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(list == NULL, err, POOL_LIST_ERR_INVALID_LIST, );
+	pool_ilist_add(list, node, list->tail, err);
+}
+
+/**
+	@fn void pool_ilist_push_front(pool_ilist* list, pool_ilist_node* node, pool_err* err)
+	@brief Adds an item to the beginning of the list
+
+	@param[inout] list The list
+	@param[inout] node The node of the item to add
+	@param[out] err The error
+*/
+POOL_FUNC void pool_ilist_push_front(pool_ilist* list, pool_ilist_node* node, pool_err* err)
+{
+	pool_ilist_add(list, node, NULL, err);
+}
+
+/**
+	@fn void pool_ilist_remove(pool_ilist* list, pool_ilist_node* node, pool_err* err)
+	@brief Removes an item from the list, the item itself is left to the caller
+
+	@param[inout] list The list
+	@param[inout] node The node of the item to remove
+	@param[out] err The error
+*/
+POOL_FUNC void pool_ilist_remove(pool_ilist* list, pool_ilist_node* node, pool_err* err)
+{
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(list == NULL, err, POOL_LIST_ERR_INVALID_LIST, );
+	POOL_SET_ERR_IF(node == NULL, err, POOL_LIST_ERR_INVALID_NODE, );
+
+	if(node == list->head)
+		list->head = node->next;
+	if(node == list->tail)
+		list->tail = node->prev;
+	if(node->prev != NULL)
+		node->prev->next = node->next;
+	if(node->next != NULL)
+		node->next->prev = node->prev;
+	node->next = NULL;
+	node->prev = NULL;
+}
+
+/**
+	@fn void pool_ilist_iterate(pool_ilist* list, pool_ilist_iterate_func func, void* data, pool_err* err)
+	@brief Iterates over all the list's items
+
+	@param[inout] list The list
+	@param[in] func The callback function, the function should return 1 to continue and 0 to stop
+	@param[in] data The data to pass to the function
+	@param[out] err The error
+*/
+POOL_FUNC void pool_ilist_iterate(pool_ilist* list, pool_ilist_iterate_func func, void* data, pool_err* err)
+{
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(list == NULL, err, POOL_LIST_ERR_INVALID_LIST, );
+	POOL_SET_ERR_IF(func == NULL, err, POOL_LIST_ERR_INVALID_FUNC, );
+	pool_ilist_node* n = list->head;
+	while(n != NULL){
+		if(!func(n, data))
+			break;
+		n = n->next;
+	}
+}
+
+/**
+	@fn pool_size pool_ilist_size(pool_ilist* list, pool_err* err)
+	@brief Calculates the size of the list
+
+	@param[in] list The list
+	@param[out] err The error
+*/
+POOL_FUNC pool_size pool_ilist_size(pool_ilist* list, pool_err* err)
+{
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(list == NULL, err, POOL_LIST_ERR_INVALID_LIST, 0);
+	pool_size size = 0;
+	pool_ilist_node* node = list->head;
+	while(node != NULL)
+	{
+		size++;
+		node = node->next;
+	}
+	return size;
+}
@@ -0,0 +1,113 @@
+/** @file */
+#ifndef ILIST_H_INCLUDED
+#define ILIST_H_INCLUDED
+
+#include "list.h"
+
+/**
+	@defgroup ILIST Intrusive doubly linked list
+	The items embed a pool_ilist_node, the list never allocates
+	@{
+*/
+
+/** Gets the item that embeds a node */
+#define POOL_ILIST_ENTRY(node, type, member) ((type*)((char*)(node) - POOL_OFFSET_OF(type, member)))
+
+/**
+	@struct _pool_ilist_node
+	@brief The link fields embedded in an item
+*/
+typedef struct _pool_ilist_node
+{
+	/** The next node (NULL if none) */
+	struct _pool_ilist_node* next;
+	/** The previous node (NULL if none) */
+	struct _pool_ilist_node* prev;
+} pool_ilist_node;
+
+/**
+	@struct _pool_ilist
+	@brief An intrusive doubly linked list
+*/
+typedef struct _pool_ilist
+{
+	/** The head of the list */
+	pool_ilist_node* head;
+	/** The tail of the list */
+	pool_ilist_node* tail;
+} pool_ilist;
+
+/** Callback function for iterate */
+typedef pool_u8 (*pool_ilist_iterate_func)(const pool_ilist_node*, void*);
+
+/**
+	@fn void pool_ilist_init(pool_ilist* list, pool_err* err)
+	@brief Initializes the list
+
+	@param[inout] list The list
+	@param[out] err The error
+*/
+POOL_FUNC void pool_ilist_init(pool_ilist* list, pool_err* err);
+
+/**
+	@fn void pool_ilist_add(pool_ilist* list, pool_ilist_node* node, pool_ilist_node* after, pool_err* err)
+	@brief Adds an item to the list
+
+	@param[inout] list The list
+	@param[inout] node The node of the item to add
+	@param[in] after The node in the list that will be placed before the new node, NULL for the beginning of the list
+	@param[out] err The error
+*/
+POOL_FUNC void pool_ilist_add(pool_ilist* list, pool_ilist_node* node, pool_ilist_node* after, pool_err* err);
+
+/**
+	@fn void pool_ilist_push_back(pool_ilist* list, pool_ilist_node* node, pool_err* err)
+	@brief Adds an item to the end of the list
+
+	@param[inout] list The list
+	@param[inout] node The node of the item to add
+	@param[out] err The error
+*/
+POOL_FUNC void pool_ilist_push_back(pool_ilist* list, pool_ilist_node* node, pool_err* err);
+
+/**
+	@fn void pool_ilist_push_front(pool_ilist* list, pool_ilist_node* node, pool_err* err)
+	@brief Adds an item to the beginning of the list
+
+	@param[inout] list The list
+	@param[inout] node The node of the item to add
+	@param[out] err The error
+*/
+POOL_FUNC void pool_ilist_push_front(pool_ilist* list, pool_ilist_node* node, pool_err* err);
+
+/**
+	@fn void pool_ilist_remove(pool_ilist* list, pool_ilist_node* node, pool_err* err)
+	@brief Removes an item from the list, the item itself is left to the caller
+
+	@param[inout] list The list
+	@param[inout] node The node of the item to remove
+	@param[out] err The error
+*/
+POOL_FUNC void pool_ilist_remove(pool_ilist* list, pool_ilist_node* node, pool_err* err);
+
+/**
+	@fn void pool_ilist_iterate(pool_ilist* list, pool_ilist_iterate_func func, void* data, pool_err* err)
+	@brief Iterates over all the list's items
+
+	@param[inout] list The list
+	@param[in] func The callback function, the function should return 1 to continue and 0 to stop
+	@param[in] data The data to pass to the function
+	@param[out] err The error
+*/
+POOL_FUNC void pool_ilist_iterate(pool_ilist* list, pool_ilist_iterate_func func, void* data, pool_err* err);
+
+/**
+	@fn pool_size pool_ilist_size(pool_ilist* list, pool_err* err)
+	@brief Calculates the size of the list
+
+	@param[in] list The list
+	@param[out] err The error
+*/
+POOL_FUNC pool_size pool_ilist_size(pool_ilist* list, pool_err* err);
+/** @} */
+#endif
@@ -1,5 +1,22 @@
 #include "list.h"
 
+/**
+	@fn static void free_nodes(pool_list* list, pool_list_node** nodes, pool_u n, pool_err* err)
+	@brief Frees detached nodes
+
+	@param[in] list The list
+	@param[in] nodes The nodes
+	@param[in] n The number of nodes
+	@param[out] err The error
+*/
+POOL_FUNC static void free_nodes(pool_list* list, pool_list_node** nodes, pool_u n, pool_err* err)
+{
+	if(list->cache != NULL)
+		pool_cache_free_batch(list->cache, (void**)nodes, n, err);
+	else
+		pool_slab_free_batch(&list->pool->slab, (void**)nodes, n, err);
+}
+
 /**
 	@fn void pool_list_init(pool_list* list, pool_t* pool, pool_err* err)
 	@brief Initializes the list
@@ -15,8 +32,31 @@ POOL_FUNC void pool_list_init(pool_list* list, pool_t* pool, pool_err* err)
 	POOL_SET_ERR_IF(pool == NULL, err, POOL_LIST_ERR_INVALID_POOL, );
 
 	list->pool = pool;
+	list->cache = NULL;
+	list->head = NULL;
+	list->tail = NULL;
+	list->size = 0;
+}
+
+/**
+	@fn void pool_list_init_cache(pool_list* list, pool_cache* cache, pool_err* err)
+	@brief Initializes the list with a cache for its nodes
+
+	@param[inout] list The list
+	@param[in] cache The node cache, made for objects of sizeof(pool_list_node) bytes
+	@param[out] err The error
+*/
+POOL_FUNC void pool_list_init_cache(pool_list* list, pool_cache* cache, pool_err* err)
+{
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(list == NULL, err, POOL_LIST_ERR_INVALID_LIST, );
+	POOL_SET_ERR_IF(cache == NULL || cache->obj_size < sizeof(pool_list_node), err, POOL_LIST_ERR_INVALID_POOL, );
+
+	list->pool = NULL;
+	list->cache = cache;
 	list->head = NULL;
 	list->tail = NULL;
+	list->size = 0;
 }
 
 /**
@@ -32,9 +72,9 @@ POOL_FUNC void pool_list_add(pool_list* list, void* data, pool_list_node* after,
 {
 	POOL_SET_ERR(err, POOL_ERR_OK);
 	POOL_SET_ERR_IF(list == NULL, err, POOL_LIST_ERR_INVALID_LIST, );
-	POOL_SET_ERR_IF(list->pool == NULL, err, POOL_LIST_ERR_INVALID_LIST, );
+	POOL_SET_ERR_IF(list->pool == NULL && list->cache == NULL, err, POOL_LIST_ERR_INVALID_LIST, );
 	pool_err err2;
-	pool_list_node* n = pool_malloc(list->pool, sizeof(pool_list_node), &err2);
+	pool_list_node* n = list->cache != NULL ? pool_cache_malloc(list->cache, &err2) : pool_malloc(list->pool, sizeof(pool_list_node), &err2);
 	POOL_SET_ERR_IF(err2 != POOL_ERR_OK, err, err2, );
 	n->data = data;
 	if(list->head == NULL)
@@ -50,6 +90,7 @@ POOL_FUNC void pool_list_add(pool_list* list, void* data, pool_list_node* after,
 		{
 			n->next = list->head;
 			n->prev = NULL;
+			list->head->prev = n;
 			list->head = n;
 		}
 		else
@@ -63,6 +104,7 @@ POOL_FUNC void pool_list_add(pool_list* list, void* data, pool_list_node* after,
 		if(after == list->tail)
 			list->tail = n;
 	}
+	list->size++;
 }
 
 /**
@@ -105,7 +147,7 @@ POOL_FUNC void pool_list_remove(pool_list* list, pool_list_node* node, pool_err*
 {
 	POOL_SET_ERR(err, POOL_ERR_OK);
 	POOL_SET_ERR_IF(list == NULL, err, POOL_LIST_ERR_INVALID_LIST, );
-	POOL_SET_ERR_IF(list->pool == NULL, err, POOL_LIST_ERR_INVALID_LIST, );
+	POOL_SET_ERR_IF(list->pool == NULL && list->cache == NULL, err, POOL_LIST_ERR_INVALID_LIST, );
 	POOL_SET_ERR_IF(node == NULL, err, POOL_LIST_ERR_INVALID_NODE, );
 
 	if(node == list->head)
@@ -116,25 +158,95 @@ POOL_FUNC void pool_list_remove(pool_list* list, pool_list_node* node, pool_err*
 		node->prev->next = node->next;
 	if(node->next != NULL)
 		node->next->prev = node->prev;
+	list->size--;
 
-	pool_free(list->pool, node, err);
+	if(list->cache != NULL)
+		pool_cache_free(list->cache, node, err);
+	else
+		pool_free(list->pool, node, err);
 }
 
 /**
-	@fn void pool_list_delete(pool_list* list, pool_err* err)
-	@brief Removes all items from the list
+	@fn void pool_list_splice(pool_list* list, pool_list_node* after, pool_list* other, pool_err* err)
+	@brief Moves all the items of another list in the list, in constant time
 
 	@param[inout] list The list
+	@param[in] after The node in the list that will be placed before the moved nodes, NULL for the beginning of the list
+	@param[inout] other The list to move, it must use the same pool and is empty afterwards
 	@param[out] err The error
 */
+POOL_FUNC void pool_list_splice(pool_list* list, pool_list_node* after, pool_list* other, pool_err* err)
+{
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(list == NULL || other == NULL || list == other, err, POOL_LIST_ERR_INVALID_LIST, );
+	POOL_SET_ERR_IF(list->pool != other->pool || list->cache != other->cache, err, POOL_LIST_ERR_INVALID_POOL, );
+	if(other->head == NULL)
+		return;
+
+	other->head->prev = after;
+	other->tail->next = after != NULL ? after->next : list->head;
+	if(after != NULL)
+		after->next = other->head;
+	else
+		list->head = other->head;
+	if(other->tail->next != NULL)
+		other->tail->next->prev = other->tail;
+	else
+		list->tail = other->tail;
+	list->size += other->size;
+
+	other->head = NULL;
+	other->tail = NULL;
+	other->size = 0;
+}
+
+/**
+	@fn void pool_list_concat(pool_list* list, pool_list* other, pool_err* err)
+	@brief Moves all the items of another list at the end of the list, in constant time
+
+	@param[inout] list The list
+	@param[inout] other The list to move, it must use the same pool and is empty afterwards
+	@param[out] err The error
+*/
+POOL_FUNC void pool_list_concat(pool_list* list, pool_list* other, pool_err* err)
+{
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(list == NULL, err, POOL_LIST_ERR_INVALID_LIST, );
+	pool_list_splice(list, list->tail, other, err);
+}
+
+/**
+	@fn void pool_list_delete(pool_list* list, pool_err* err)
+	@brief Removes all items from the list, the nodes are freed in batches
+
+	@param[inout] list The list
+	@param[out] err The error (the first one, the other nodes are still freed)
+*/
 POOL_FUNC void pool_list_delete(pool_list* list, pool_err* err)
 {
 	POOL_SET_ERR(err, POOL_ERR_OK);
 	POOL_SET_ERR_IF(list == NULL, err, POOL_LIST_ERR_INVALID_LIST, );
-	while(list->head != NULL)
+	POOL_SET_ERR_IF(list->pool == NULL && list->cache == NULL, err, POOL_LIST_ERR_INVALID_LIST, );
+	pool_list_node* batch[POOL_LIST_FREE_BATCH];
+	pool_list_node* n = list->head;
+	pool_u count = 0;
+	pool_err err2;
+	// The whole list is detached first, the nodes are not unlinked one by one
+	list->head = NULL;
+	list->tail = NULL;
+	list->size = 0;
+	while(n != NULL)
 	{
-		pool_list_remove(list, list->head, err);
-		POOL_SET_ERR_IF(err != NULL ? *err : POOL_ERR_OK, err, *err, );
+		batch[count++] = n;
+		n = n->next;
+		if(count == POOL_LIST_FREE_BATCH || n == NULL)
+		{
+			// The detached nodes cannot be reached again, the next batches are still freed and the first error is kept
+			free_nodes(list, batch, count, &err2);
+			if(err2 != POOL_ERR_OK && (err == NULL || *err == POOL_ERR_OK))
+				POOL_SET_ERR(err, err2);
+			count = 0;
+		}
 	}
 }
 
@@ -162,7 +274,7 @@ POOL_FUNC void pool_list_iterate(pool_list* list, pool_list_iterate_func func, v
 
 /**
  * @fn pool_size pool_list_size(pool_list* list, pool_err* err)
- * @brief Calculates the size of the list
+ * @brief Gets the size of the list
  *
  * @param[in] list The list
  * @param[out] err The error
@@ -171,12 +283,5 @@ POOL_FUNC pool_size pool_list_size(pool_list* list, pool_err* err)
 {
 	POOL_SET_ERR(err, POOL_ERR_OK);
 	POOL_SET_ERR_IF(list == NULL, err, POOL_LIST_ERR_INVALID_LIST, 0);
-	pool_size size = 0;
-	pool_list_node* node = list->head;
-	while(node != NULL)
-	{
-		size++;
-		node = node->next;
-	}
-	return size;
+	return list->size;
 }
@@ -3,12 +3,18 @@
 #define LIST_H_INCLUDED
 
 #include "pool.h"
+#include "pool_cache.h"
 
 #define POOL_LIST_ERR_INVALID_LIST 5
 #define POOL_LIST_ERR_INVALID_POOL 6
 #define POOL_LIST_ERR_INVALID_NODE 7
 #define POOL_LIST_ERR_INVALID_FUNC 8
 
+/** Number of nodes freed at once by pool_list_delete */
+#ifndef POOL_LIST_FREE_BATCH
+#define POOL_LIST_FREE_BATCH 32
+#endif
+
 /**
 	@defgroup LIST Doubly linked list
 	@{
@@ -34,12 +40,16 @@ typedef struct _pool_list_node
 */
 typedef struct _pool_list
 {
-	/** The pool used by the list */
+	/** The pool used by the list (NULL if the list uses a cache) */
 	pool_t* pool;
+	/** The cache of the nodes (NULL if the list uses a pool) */
+	pool_cache* cache;
 	/** The head of the list */
 	pool_list_node* head;
 	/** The tail of the list */
 	pool_list_node* tail;
+	/** The number of items */
+	pool_size size;
 } pool_list;
 
 /** Callback function for iterate */
@@ -55,6 +65,16 @@ typedef pool_u8 (*pool_list_iterate_func)(const pool_list_node*, void*);
 */
 POOL_FUNC void pool_list_init(pool_list* list, pool_t* pool, pool_err* err);
 
+/**
+	@fn void pool_list_init_cache(pool_list* list, pool_cache* cache, pool_err* err)
+	@brief Initializes the list with a cache for its nodes
+
+	@param[inout] list The list
+	@param[in] cache The node cache, made for objects of sizeof(pool_list_node) bytes
+	@param[out] err The error
+*/
+POOL_FUNC void pool_list_init_cache(pool_list* list, pool_cache* cache, pool_err* err);
+
 /**
 	@fn void pool_list_add(pool_list* list, void* data, pool_list_node* after, pool_err* err)
 	@brief Adds an item to the list
@@ -97,12 +117,33 @@ POOL_FUNC void pool_list_push_front(pool_list* list, void* data, pool_err* err);
 POOL_FUNC void pool_list_remove(pool_list* list, pool_list_node* node, pool_err* err);
 
 /**
-	@fn void pool_list_delete(pool_list* list, pool_err* err)
-	@brief Removes all items from the list
+	@fn void pool_list_splice(pool_list* list, pool_list_node* after, pool_list* other, pool_err* err)
+	@brief Moves all the items of another list in the list, in constant time
 
 	@param[inout] list The list
+	@param[in] after The node in the list that will be placed before the moved nodes, NULL for the beginning of the list
+	@param[inout] other The list to move, it must use the same pool and is empty afterwards
 	@param[out] err The error
 */
+POOL_FUNC void pool_list_splice(pool_list* list, pool_list_node* after, pool_list* other, pool_err* err);
+
+/**
+	@fn void pool_list_concat(pool_list* list, pool_list* other, pool_err* err)
+	@brief Moves all the items of another list at the end of the list, in constant time
+
+	@param[inout] list The list
+	@param[inout] other The list to move, it must use the same pool and is empty afterwards
+	@param[out] err The error
+*/
+POOL_FUNC void pool_list_concat(pool_list* list, pool_list* other, pool_err* err);
+
+/**
+	@fn void pool_list_delete(pool_list* list, pool_err* err)
+	@brief Removes all items from the list, the nodes are freed in batches
+
+	@param[inout] list The list
+	@param[out] err The error (the first one, the other nodes are still freed)
+*/
 POOL_FUNC void pool_list_delete(pool_list* list, pool_err* err);
 
 /**
@@ -118,7 +159,7 @@ POOL_FUNC void pool_list_iterate(pool_list* list, pool_list_iterate_func func, v
 
 /**
  * @fn pool_size pool_list_size(pool_list* list, pool_err* err)
- * @brief Calculates the size of the list
+ * @brief Gets the size of the list
  *
  * @param[in] list The list
  * @param[out] err The error
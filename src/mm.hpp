@@ -0,0 +1,435 @@
+/** @file */
+#ifndef MM_HPP_INCLUDED
+#define MM_HPP_INCLUDED
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#if __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+/** Defined when std::pmr is available, mm::pool_resource is then declared */
+#define MM_HAS_PMR
+#endif
+#endif
+
+#include "pool_slab.h"
+
+/**
+@defgroup CPP C++ wrapper
+Slab pools whose geometry is fixed at compile time, several geometries can be used in one program
+@{
+*/
+
+/** The C++ wrapper namespace */
+namespace mm
+{
+	/** Log 2 of n (rounded down), at compile time */
+	constexpr pool_u log2(pool_u n)
+	{
+		return n <= 1 ? 0 : 1 + log2(n / 2);
+	}
+
+	/** Log 2 of n (rounded up), at compile time */
+	constexpr pool_u log2_ceil(pool_u n)
+	{
+		return n <= 1 ? 0 : log2(n - 1) + 1;
+	}
+
+	/**
+		@class slab_pool
+		@brief A slab pool that holds its memory and metadata, sized at compile time
+
+		@tparam MaxSize The size of the memory
+		@tparam PageSize The size of a page (power of 2)
+		@tparam BlockSize The size of a buddy block (power of 2)
+	*/
+	template<pool_size MaxSize, pool_size PageSize = POOL_PAGE_SIZE, pool_size BlockSize = POOL_BUDDY_BLOCK_SIZE>
+	class slab_pool
+	{
+		static_assert(POOL_IS_POW2(PageSize), "The page size must be a power of 2");
+		static_assert(POOL_IS_POW2(BlockSize), "The block size must be a power of 2");
+		static_assert(BlockSize <= PageSize, "The block size must not be larger than the page size");
+		static_assert(MaxSize >= PageSize, "The pool must hold at least one page");
+		static_assert(log2(PageSize / BlockSize) < POOL_BUDDY_ORDER_MAX, "Too many blocks per page");
+
+	public:
+		/** Size of the memory */
+		static constexpr pool_size max_size = MaxSize;
+		/** Size of a page */
+		static constexpr pool_size page_size = PageSize;
+		/** Size of a buddy block */
+		static constexpr pool_size block_size = BlockSize;
+		/** Number of pages */
+		static constexpr pool_u page_n = MaxSize / PageSize;
+		/** Log 2 of the page size */
+		static constexpr pool_u page_shift = log2(PageSize);
+		/** Log 2 of the block size */
+		static constexpr pool_u block_shift = log2(BlockSize);
+		/** Depth of the buddy tree of a page, also the order of a whole page */
+		static constexpr pool_u depth = log2(PageSize / BlockSize);
+		/** Size of the metadata */
+		static constexpr pool_size meta_size = POOL_SLAB_META_SIZE(MaxSize, PageSize, BlockSize);
+
+		/** Checks if size bytes take a RAW buffer (whole pages) */
+		static constexpr bool is_raw(pool_size size)
+		{
+			return size > PageSize;
+		}
+
+		/** Order of the buddy block of size bytes (POOL_BUDDY_ORDER_NONE for a RAW buffer) */
+		static constexpr pool_u8 order(pool_size size)
+		{
+			return is_raw(size) ? POOL_BUDDY_ORDER_NONE : (pool_u8)log2_ceil((size + BlockSize - 1) >> block_shift);
+		}
+
+		/** Number of bytes taken by size bytes (a block or whole pages) */
+		static constexpr pool_size footprint(pool_size size)
+		{
+			return is_raw(size) ? POOL_ALIGN_UP(size, PageSize) : BlockSize << order(size);
+		}
+
+		/**
+			@brief Initializes the pool
+
+			@param[out] err The error that happened
+		*/
+		explicit slab_pool(pool_err* err = nullptr)
+		{
+			pool_slab_init(&slab_, mem_, MaxSize, PageSize, BlockSize, meta_, err);
+		}
+
+		slab_pool(const slab_pool&) = delete;
+		slab_pool& operator=(const slab_pool&) = delete;
+
+		/** @see pool_slab_malloc */
+		void* malloc(pool_size size, pool_err* err = nullptr)
+		{
+			return pool_slab_malloc(&slab_, size, err);
+		}
+
+		/** @see pool_slab_memalign */
+		void* memalign(pool_size align, pool_size size, pool_err* err = nullptr)
+		{
+			return pool_slab_memalign(&slab_, align, size, err);
+		}
+
+		/** @see pool_slab_realloc */
+		void* realloc(void* ptr, pool_size size, pool_err* err = nullptr)
+		{
+			return pool_slab_realloc(&slab_, ptr, size, err);
+		}
+
+		/** @see pool_slab_free */
+		void free(void* ptr, pool_err* err = nullptr)
+		{
+			pool_slab_free(&slab_, ptr, err);
+		}
+
+		/** @see pool_slab_free_sized */
+		void free(void* ptr, pool_size size, pool_err* err = nullptr)
+		{
+			pool_slab_free_sized(&slab_, ptr, size, err);
+		}
+
+		/**
+			@brief Allocates and constructs a T
+
+			@param[in] args The arguments of the constructor
+
+			@return The object, nullptr if the pool is full
+		*/
+		template<class T, class... Args>
+		T* create(Args&&... args)
+		{
+			static_assert(alignof(T) <= PageSize, "The type is more aligned than a page");
+			void* ptr = alignof(T) > BlockSize ? memalign(alignof(T), sizeof(T)) : malloc(sizeof(T));
+			return ptr != nullptr ? new (ptr) T(std::forward<Args>(args)...) : nullptr;
+		}
+
+		/**
+			@brief Destroys and frees an object made by create, its size is known so its block is not searched
+
+			@param[in] obj The object
+		*/
+		template<class T>
+		void destroy(T* obj)
+		{
+			if (obj == nullptr)
+				return;
+			obj->~T();
+			free(obj, sizeof(T));
+		}
+
+		/** @see pool_slab_stat */
+		void stat(pool_slab_stats* stats, pool_err* err = nullptr)
+		{
+			pool_slab_stat(&slab_, stats, err);
+		}
+
+		/** @see pool_slab_size */
+		pool_size size()
+		{
+			return pool_slab_size(&slab_, nullptr);
+		}
+
+		/** The C pool, for the C API */
+		pool_slab* get()
+		{
+			return &slab_;
+		}
+
+		/** The C pool, for the C API */
+		operator pool_slab*()
+		{
+			return &slab_;
+		}
+
+	private:
+		/** The slab pool */
+		pool_slab slab_;
+		/** The metadata */
+		void* meta_[POOL_CEIL_DIV(meta_size, sizeof(void*))];
+		/** The memory, page aligned so memalign works up to the page size */
+		alignas(PageSize) unsigned char mem_[MaxSize];
+	};
+
+	/**
+		@brief Checks if a pointer is in the memory of a pool
+
+		@param[in] p The slab pool
+		@param[in] ptr The pointer
+
+		@return true if the pool holds the pointer
+	*/
+	inline bool owns(const pool_slab* p, const void* ptr)
+	{
+		return (const char*)ptr >= (const char*)p->mem && (const char*)ptr < (const char*)p->mem + ((pool_size)p->page_n << p->page_shift);
+	}
+
+	/**
+		@brief Allocates size bytes aligned to align in a pool
+
+		@param[in] p The slab pool
+		@param[in] size The number of bytes
+		@param[in] align The alignment (power of 2)
+
+		@return The buffer, nullptr if the pool cannot hold it
+	*/
+	inline void* pool_allocate(pool_slab* p, std::size_t size, std::size_t align)
+	{
+		return pool_slab_memalign(p, align, size != 0 ? size : 1, nullptr);
+	}
+
+	/**
+		@brief Frees a buffer given by pool_allocate, with its size so its block is not searched
+
+		@param[in] p The slab pool
+		@param[in] ptr The buffer
+		@param[in] size The size given to pool_allocate
+		@param[in] align The alignment given to pool_allocate
+	*/
+	inline void pool_deallocate(pool_slab* p, void* ptr, std::size_t size, std::size_t align)
+	{
+		// memalign takes at least align bytes up to a page, above it the pages of size
+		size = size != 0 ? size : 1;
+		size = align <= p->page_size && size < align ? align : size;
+#ifdef POOL_DEBUG
+		// A size that does not match the block is reported, free by search so the buffer is not lost
+		pool_err err;
+		pool_slab_free_sized(p, ptr, size, &err);
+		if (err != POOL_ERR_OK)
+			pool_slab_free(p, ptr, nullptr);
+#else
+		pool_slab_free_sized(p, ptr, size, nullptr);
+#endif
+	}
+
+	/**
+		@class allocator
+		@brief A standard allocator over a slab pool, falls back to operator new when the pool is full
+
+		@tparam T The allocated type
+	*/
+	template<class T>
+	class allocator
+	{
+		template<class U> friend class allocator;
+
+	public:
+		/** The allocated type */
+		typedef T value_type;
+
+		/**
+			@brief Makes an allocator over a pool
+
+			@param[in] pool The slab pool
+			@param[in] fallback If the global operator new is used when the pool is full
+		*/
+		allocator(pool_slab* pool, bool fallback = true) noexcept : pool_(pool), fallback_(fallback)
+		{
+		}
+
+		/** Rebinds an allocator of another type */
+		template<class U>
+		allocator(const allocator<U>& other) noexcept : pool_(other.pool_), fallback_(other.fallback_)
+		{
+		}
+
+		/**
+			@brief Allocates n objects
+
+			@param[in] n The number of objects
+
+			@return The buffer, throws std::bad_alloc if neither the pool nor the fallback can hold it
+		*/
+		T* allocate(std::size_t n)
+		{
+			void* ptr;
+			if (n > (std::size_t)-1 / sizeof(T))
+				throw std::bad_alloc();
+			ptr = pool_allocate(pool_, n * sizeof(T), alignof(T));
+			if (ptr == nullptr && fallback_)
+				ptr = upstream_allocate(n * sizeof(T));
+			if (ptr == nullptr)
+				throw std::bad_alloc();
+			return (T*)ptr;
+		}
+
+		/**
+			@brief Frees n objects
+
+			@param[in] ptr The buffer given by allocate
+			@param[in] n The number of objects given to allocate
+		*/
+		void deallocate(T* ptr, std::size_t n) noexcept
+		{
+			if (owns(pool_, ptr))
+				pool_deallocate(pool_, ptr, n * sizeof(T), alignof(T));
+			else
+				upstream_deallocate(ptr, n * sizeof(T));
+		}
+
+		/** The slab pool */
+		pool_slab* pool() const noexcept
+		{
+			return pool_;
+		}
+
+		/** Two allocators are equal if they use the same pool */
+		template<class U>
+		bool operator==(const allocator<U>& other) const noexcept
+		{
+			return pool_ == other.pool_;
+		}
+
+		/** Two allocators are equal if they use the same pool */
+		template<class U>
+		bool operator!=(const allocator<U>& other) const noexcept
+		{
+			return pool_ != other.pool_;
+		}
+
+	private:
+		/** Allocates size bytes with the global operator new */
+		static void* upstream_allocate(std::size_t size)
+		{
+#ifdef __cpp_aligned_new
+			if (alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+				return ::operator new(size, std::align_val_t(alignof(T)), std::nothrow);
+#endif
+			return alignof(T) <= alignof(std::max_align_t) ? ::operator new(size, std::nothrow) : nullptr;
+		}
+
+		/** Frees a buffer given by upstream_allocate */
+		static void upstream_deallocate(void* ptr, std::size_t size)
+		{
+			(void)size;
+#ifdef __cpp_aligned_new
+			if (alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+			{
+				::operator delete(ptr, std::align_val_t(alignof(T)));
+				return;
+			}
+#endif
+			::operator delete(ptr);
+		}
+
+		/** The slab pool */
+		pool_slab* pool_;
+		/** If operator new is used when the pool is full */
+		bool fallback_;
+	};
+
+#ifdef MM_HAS_PMR
+	/**
+		@class pool_resource
+		@brief A memory resource over a slab pool, falls back to an upstream resource when the pool is full
+	*/
+	class pool_resource : public std::pmr::memory_resource
+	{
+	public:
+		/**
+			@brief Makes a memory resource over a pool
+
+			@param[in] pool The slab pool
+			@param[in] upstream Allocates when the pool is full (nullptr to throw std::bad_alloc instead)
+		*/
+		explicit pool_resource(pool_slab* pool, std::pmr::memory_resource* upstream = std::pmr::get_default_resource()) noexcept : pool_(pool), upstream_(upstream)
+		{
+		}
+
+		pool_resource(const pool_resource&) = delete;
+		pool_resource& operator=(const pool_resource&) = delete;
+
+		/** The slab pool */
+		pool_slab* pool() const noexcept
+		{
+			return pool_;
+		}
+
+		/** The upstream resource */
+		std::pmr::memory_resource* upstream_resource() const noexcept
+		{
+			return upstream_;
+		}
+
+	protected:
+		/** Allocates in the pool, then in the upstream resource */
+		void* do_allocate(std::size_t size, std::size_t align) override
+		{
+			void* ptr = pool_allocate(pool_, size, align);
+			if (ptr != nullptr)
+				return ptr;
+			if (upstream_ == nullptr)
+				throw std::bad_alloc();
+			return upstream_->allocate(size, align);
+		}
+
+		/** Frees in the pool or in the upstream resource, with the size */
+		void do_deallocate(void* ptr, std::size_t size, std::size_t align) override
+		{
+			if (owns(pool_, ptr))
+				pool_deallocate(pool_, ptr, size, align);
+			else
+				upstream_->deallocate(ptr, size, align);
+		}
+
+		/** Two resources are equal if they are the same */
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+		{
+			return this == &other;
+		}
+
+	private:
+		/** The slab pool */
+		pool_slab* pool_;
+		/** Allocates when the pool is full */
+		std::pmr::memory_resource* upstream_;
+	};
+#endif
+}
+
+/** @} */
+
+#endif
@@ -8,15 +8,15 @@
 @defgroup POOL Memory pool
 @{
 */
-/** pool_slab_init redefine */
-#define pool_init pool_slab_init
+/** pool_slab_static_init redefine */
+#define pool_init(p, mem, err) pool_slab_static_init(p, mem, err)
 /** pool_slab_malloc redefine */
-#define pool_malloc pool_slab_malloc
+#define pool_malloc(p, size, err) pool_slab_malloc(&(p)->slab, size, err)
 /** pool_slab_free redefine */
-#define pool_free pool_slab_free
+#define pool_free(p, ptr, err) pool_slab_free(&(p)->slab, ptr, err)
 
-/** Pool type */
-typedef pool_slab pool_t;
+/** Pool type (default geometry) */
+typedef pool_slab_static pool_t;
 
 /** @} */
 
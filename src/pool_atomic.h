@@ -0,0 +1,62 @@
+/** @file */
+#ifndef POOL_ATOMIC_H_INCLUDED
+#define POOL_ATOMIC_H_INCLUDED
+
+#include "pool_defs.h"
+
+/**
+@defgroup ATOMIC Atomic operations and spin locks
+Define POOL_CONCURRENT to share a slab pool between threads, without it
+the operations are plain loads and stores and the locks disappear
+@{
+*/
+
+/** Spin lock type (0 when free) */
+typedef pool_u8 pool_lock;
+
+#ifdef POOL_CONCURRENT
+
+#if defined(__GNUC__)
+/** Loads a byte with acquire semantics */
+#define POOL_ATOMIC_LOAD(ptr) __atomic_load_n(ptr, __ATOMIC_ACQUIRE)
+/** Replaces a byte if it still holds expected, evaluates to 1 on success */
+#define POOL_ATOMIC_CAS(ptr, expected, desired) __sync_bool_compare_and_swap(ptr, expected, desired)
+/** Tries to take a lock, evaluates to 1 on success */
+#define POOL_LOCK_TRY(lock) (__sync_lock_test_and_set(lock, 1) == 0)
+/** Releases a lock */
+#define POOL_LOCK_RELEASE(lock) __sync_lock_release(lock)
+#elif defined(_MSC_VER)
+#include <intrin.h>
+/** Loads a byte with acquire semantics */
+#define POOL_ATOMIC_LOAD(ptr) (*(volatile pool_u8*)(ptr))
+/** Replaces a byte if it still holds expected, evaluates to 1 on success */
+#define POOL_ATOMIC_CAS(ptr, expected, desired) (_InterlockedCompareExchange8((volatile char*)(ptr), (char)(desired), (char)(expected)) == (char)(expected))
+/** Tries to take a lock, evaluates to 1 on success */
+#define POOL_LOCK_TRY(lock) (_InterlockedExchange8((volatile char*)(lock), 1) == 0)
+/** Releases a lock */
+#define POOL_LOCK_RELEASE(lock) _InterlockedExchange8((volatile char*)(lock), 0)
+#else
+#error "POOL_CONCURRENT needs the GCC, Clang or MSVC atomic builtins"
+#endif
+
+/** Takes a lock, spinning on plain loads while it is held */
+#define POOL_LOCK_ACQUIRE(lock) do { while (!POOL_LOCK_TRY(lock)) while (POOL_ATOMIC_LOAD(lock)); } while (0)
+
+#else
+
+/** Loads a byte */
+#define POOL_ATOMIC_LOAD(ptr) (*(ptr))
+/** Replaces a byte if it holds expected, evaluates to 1 on success */
+#define POOL_ATOMIC_CAS(ptr, expected, desired) (*(ptr) == (expected) ? (*(ptr) = (desired), 1) : 0)
+/** Tries to take a lock (always succeeds) */
+#define POOL_LOCK_TRY(lock) 1
+/** Takes a lock (nothing to do) */
+#define POOL_LOCK_ACQUIRE(lock)
+/** Releases a lock (nothing to do) */
+#define POOL_LOCK_RELEASE(lock)
+
+#endif
+
+/** @} */
+
+#endif
@@ -0,0 +1,152 @@
+#include "pool_bitmap.h"
+
+/**
+	@fn static pool_u range_mask(pool_u from, pool_u to)
+	@brief Mask of the bits [from, to[ of a word
+
+	@param[in] from The first bit (< POOL_U_BITS)
+	@param[in] to The bit after the last one (<= POOL_U_BITS)
+
+	@return The mask
+*/
+POOL_FUNC static pool_u range_mask(pool_u from, pool_u to)
+{
+	pool_u high = to == POOL_U_BITS ? ~(pool_u)0 : ((pool_u)1 << to) - 1;
+	return high & ~(((pool_u)1 << from) - 1);
+}
+
+/**
+	@fn void pool_bitmap_set_range(pool_u* map, pool_u from, pool_u n)
+	@brief Sets n bits of the bitmap
+
+	@param[inout] map The bitmap
+	@param[in] from The first bit
+	@param[in] n The number of bits
+*/
+POOL_FUNC void pool_bitmap_set_range(pool_u* map, pool_u from, pool_u n)
+{
+	pool_u to = from + n;
+	pool_u end;
+	while (from < to)
+	{
+		end = (from / POOL_U_BITS + 1)*POOL_U_BITS;
+		if (end > to)
+			end = to;
+		map[from / POOL_U_BITS] |= range_mask(from % POOL_U_BITS, end - from + from % POOL_U_BITS);
+		from = end;
+	}
+}
+
+/**
+	@fn void pool_bitmap_clear_range(pool_u* map, pool_u from, pool_u n)
+	@brief Clears n bits of the bitmap
+
+	@param[inout] map The bitmap
+	@param[in] from The first bit
+	@param[in] n The number of bits
+*/
+POOL_FUNC void pool_bitmap_clear_range(pool_u* map, pool_u from, pool_u n)
+{
+	pool_u to = from + n;
+	pool_u end;
+	while (from < to)
+	{
+		end = (from / POOL_U_BITS + 1)*POOL_U_BITS;
+		if (end > to)
+			end = to;
+		map[from / POOL_U_BITS] &= ~range_mask(from % POOL_U_BITS, end - from + from % POOL_U_BITS);
+		from = end;
+	}
+}
+
+/**
+	@fn pool_u pool_bitmap_next_set(const pool_u* map, pool_u size, pool_u from)
+	@brief Finds the next set bit
+
+	@param[in] map The bitmap
+	@param[in] size The number of bits in the bitmap
+	@param[in] from The first bit to look at
+
+	@return The index of the bit, size if none
+*/
+POOL_FUNC pool_u pool_bitmap_next_set(const pool_u* map, pool_u size, pool_u from)
+{
+	pool_u i = from / POOL_U_BITS;
+	pool_u word;
+	if (from >= size)
+		return size;
+	word = map[i] & ~(((pool_u)1 << (from % POOL_U_BITS)) - 1);
+	while (word == 0)
+	{
+		if (++i >= POOL_BITMAP_SIZE(size))
+			return size;
+		word = map[i];
+	}
+	from = i*POOL_U_BITS + POOL_CTZ(word);
+	return from < size ? from : size;
+}
+
+/**
+	@fn pool_u pool_bitmap_next_clear(const pool_u* map, pool_u size, pool_u from)
+	@brief Finds the next cleared bit
+
+	@param[in] map The bitmap
+	@param[in] size The number of bits in the bitmap
+	@param[in] from The first bit to look at
+
+	@return The index of the bit, size if none
+*/
+POOL_FUNC pool_u pool_bitmap_next_clear(const pool_u* map, pool_u size, pool_u from)
+{
+	pool_u i = from / POOL_U_BITS;
+	pool_u word;
+	if (from >= size)
+		return size;
+	word = ~map[i] & ~(((pool_u)1 << (from % POOL_U_BITS)) - 1);
+	while (word == 0)
+	{
+		if (++i >= POOL_BITMAP_SIZE(size))
+			return size;
+		word = ~map[i];
+	}
+	from = i*POOL_U_BITS + POOL_CTZ(word);
+	return from < size ? from : size;
+}
+
+/**
+	@fn pool_u pool_bitmap_find_run(const pool_u* map, pool_u size, pool_u n, pool_u8 fit)
+	@brief Finds a run of n set bits
+
+	@param[in] map The bitmap
+	@param[in] size The number of bits in the bitmap
+	@param[in] n The length of the run
+	@param[in] fit POOL_BITMAP_FIRST_FIT or POOL_BITMAP_BEST_FIT
+
+	@return The first bit of the run, size if none
+*/
+POOL_FUNC pool_u pool_bitmap_find_run(const pool_u* map, pool_u size, pool_u n, pool_u8 fit)
+{
+	pool_u start, end;
+	pool_u best = size;
+	pool_u best_len = 0;
+	if (n == 0 || n > size)
+		return size;
+	// Jumps from run to run, whole words of set or cleared bits are skipped at once
+	start = pool_bitmap_next_set(map, size, 0);
+	while (start + n <= size)
+	{
+		end = pool_bitmap_next_clear(map, size, start);
+		if (end - start >= n)
+		{
+			if (fit == POOL_BITMAP_FIRST_FIT || end - start == n)
+				return start;
+			if (best == size || end - start < best_len)
+			{
+				best = start;
+				best_len = end - start;
+			}
+		}
+		start = pool_bitmap_next_set(map, size, end);
+	}
+	return best;
+}
@@ -0,0 +1,82 @@
+/** @file */
+#ifndef POOL_BITMAP_H_INCLUDED
+#define POOL_BITMAP_H_INCLUDED
+
+#include "pool_defs.h"
+
+/**
+@defgroup BITMAP Word bitmap
+@{
+*/
+
+/** Number of words of a bitmap of n bits */
+#define POOL_BITMAP_SIZE(n) (POOL_CEIL_DIV(n, POOL_U_BITS))
+
+/** Gets bit i of a bitmap */
+#define POOL_BITMAP_GET(map, i) (((map)[(i) / POOL_U_BITS] >> ((i) % POOL_U_BITS)) & 1)
+
+/** Takes the first run that is long enough */
+#define POOL_BITMAP_FIRST_FIT 0
+/** Takes the shortest run that is long enough */
+#define POOL_BITMAP_BEST_FIT 1
+
+/**
+	@fn void pool_bitmap_set_range(pool_u* map, pool_u from, pool_u n)
+	@brief Sets n bits of the bitmap
+
+	@param[inout] map The bitmap
+	@param[in] from The first bit
+	@param[in] n The number of bits
+*/
+POOL_FUNC void pool_bitmap_set_range(pool_u* map, pool_u from, pool_u n);
+
+/**
+	@fn void pool_bitmap_clear_range(pool_u* map, pool_u from, pool_u n)
+	@brief Clears n bits of the bitmap
+
+	@param[inout] map The bitmap
+	@param[in] from The first bit
+	@param[in] n The number of bits
+*/
+POOL_FUNC void pool_bitmap_clear_range(pool_u* map, pool_u from, pool_u n);
+
+/**
+	@fn pool_u pool_bitmap_next_set(const pool_u* map, pool_u size, pool_u from)
+	@brief Finds the next set bit
+
+	@param[in] map The bitmap
+	@param[in] size The number of bits in the bitmap
+	@param[in] from The first bit to look at
+
+	@return The index of the bit, size if none
+*/
+POOL_FUNC pool_u pool_bitmap_next_set(const pool_u* map, pool_u size, pool_u from);
+
+/**
+	@fn pool_u pool_bitmap_next_clear(const pool_u* map, pool_u size, pool_u from)
+	@brief Finds the next cleared bit
+
+	@param[in] map The bitmap
+	@param[in] size The number of bits in the bitmap
+	@param[in] from The first bit to look at
+
+	@return The index of the bit, size if none
+*/
+POOL_FUNC pool_u pool_bitmap_next_clear(const pool_u* map, pool_u size, pool_u from);
+
+/**
+	@fn pool_u pool_bitmap_find_run(const pool_u* map, pool_u size, pool_u n, pool_u8 fit)
+	@brief Finds a run of n set bits
+
+	@param[in] map The bitmap
+	@param[in] size The number of bits in the bitmap
+	@param[in] n The length of the run
+	@param[in] fit POOL_BITMAP_FIRST_FIT or POOL_BITMAP_BEST_FIT
+
+	@return The first bit of the run, size if none
+*/
+POOL_FUNC pool_u pool_bitmap_find_run(const pool_u* map, pool_u size, pool_u n, pool_u8 fit);
+
+/** @} */
+
+#endif
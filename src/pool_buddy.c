@@ -1,92 +1,128 @@
 #include "pool_buddy.h"
 
+/** Number of blocks of a buddy */
+#define BLOCK_N(p) ((pool_u)1 << (p)->depth)
+/** The tree of a buddy */
+#define TREE(p) ((pool_u8*)((pool_u)(p) + (p)->tree_offset))
+/** The memory base of a buddy */
+#define MEM(p) ((char*)((pool_u)(p) + (p)->mem_offset))
+/** The leaves bitmap of a buddy */
+#define LEAVES(p) (TREE(p) + BLOCK_N(p))
 
 /**
-	@fn void pool_buddy_init(pool_buddy* p, void* mem, pool_err* err)
-	@brief Initializes the structure
+	@fn static pool_u8 node_value(pool_buddy* p, pool_u pos)
+	@brief Gets the order of the largest free block under a node + 1
 
-	@param[out] p The buddy struct
-	@param[in] mem The memory base
-	@param[out] err The error that happened
+	@param[in] p The buddy struct
+	@param[in] pos The position in the tree
+
+	@return The order of the largest free block + 1, 0 if none
 */
-POOL_FUNC void pool_buddy_init(pool_buddy* p, void* mem, pool_err* err)
+POOL_FUNC static pool_u8 node_value(pool_buddy* p, pool_u pos)
 {
-	pool_u i;
-	POOL_SET_ERR(err, POOL_ERR_OK);
-	POOL_SET_ERR_IF(p == NULL, err, POOL_ERR_INVALID_POOL, );
-	POOL_SET_ERR_IF(mem == NULL, err, POOL_ERR_INVALID_PTR, );
-	p->mem = mem;
-	p->allocated = 0;
-
-	for (i = 0; i < POOL_BUDDY_TREE_SIZE; i++)
-		p->tree[i] = 0xff;
-	p->tree[0] = 0x7f;
+	if (pos >= BLOCK_N(p))
+		return POOL_GET_BIT(LEAVES(p), pos - BLOCK_N(p));
+	if (TREE(p)[pos] == POOL_BUDDY_NODE_USED)
+		return 0;
+	return TREE(p)[pos];
 }
 
 /**
-	@fn static pool_u check_pos(pool_u8* tree, pool_u pos, pool_u8 depth)
-	@brief Checks if a memory slot (at pos) is free
-
-	@param[in] tree The buddy tree
-	@param[in] pos The memory slot
-	@param[in] depth The depth of the tree
+	@fn static void node_set_used(pool_buddy* p, pool_u pos)
+	@brief Marks a node as allocated
 
-	@return 1 If available, 0 if not
+	@param[inout] p The buddy struct
+	@param[in] pos The position in the tree
 */
-POOL_FUNC static pool_u check_pos(pool_u8* tree, pool_u pos, pool_u8 depth)
+POOL_FUNC static void node_set_used(pool_buddy* p, pool_u pos)
 {
-	pool_u pos_level = pool_log2(pos);
-	if (pos_level > depth)
-		return 1;
-	if (POOL_GET_BIT(tree, pos) == 0)
-		return 0;
-	if (check_pos(tree, 2 * pos, depth) == 0)
-		return 0;
-	if (check_pos(tree, 2 * pos + 1, depth) == 0)
-		return 0;
-	return 1;
+	if (pos >= BLOCK_N(p))
+		POOL_UST_BIT(LEAVES(p), pos - BLOCK_N(p));
+	else
+		TREE(p)[pos] = POOL_BUDDY_NODE_USED;
 }
 
+/**
+	@fn static void node_set_free(pool_buddy* p, pool_u pos, pool_u8 level)
+	@brief Marks a node as free
+
+	@param[inout] p The buddy struct
+	@param[in] pos The position in the tree
+	@param[in] level The level of the node
+*/
+POOL_FUNC static void node_set_free(pool_buddy* p, pool_u pos, pool_u8 level)
+{
+	if (pos >= BLOCK_N(p))
+		POOL_SET_BIT(LEAVES(p), pos - BLOCK_N(p));
+	else
+		TREE(p)[pos] = p->depth - level + 1;
+}
 
 /**
-	@fn static pool_u find_pos(pool_u8* tree, pool_u8 max_level, pool_u pos, pool_u8 depth)
-	@brief Finds an available memory slot
-	
-	@param[in] tree The buddy tree
-	@param[in] max_level The level in the tree to allocate into
-	@param[in] pos The position in the tree we are looking at
-	@param[in] depth The depth of the tree
+	@fn static void update_parents(pool_buddy* p, pool_u pos, pool_u8 level)
+	@brief Updates the largest free order of the ancestors of a node
 
-	@return The position in the tree of an available memory slot, 0 if none
+	@param[inout] p The buddy struct
+	@param[in] pos The position in the tree of the node that changed
+	@param[in] level The level of the node
 */
-POOL_FUNC static pool_u find_pos(pool_u8* tree, pool_u8 max_level, pool_u pos, pool_u8 depth)
+POOL_FUNC static void update_parents(pool_buddy* p, pool_u pos, pool_u8 level)
 {
-	pool_u level = pool_log2(pos);
-	pool_u res = 0;
-	if (level > max_level)
-		return 0;
-	if (level == max_level)
+	pool_u8 left, right, full, value;
+	while (pos > 1)
 	{
-		if (POOL_GET_BIT(tree, pos) && check_pos(tree, pos, depth))
-			return pos;
+		pos /= 2;
+		level--;
+		left = node_value(p, 2 * pos);
+		right = node_value(p, 2 * pos + 1);
+		full = p->depth - level;
+		if (left == full && right == full)
+			value = full + 1;
 		else
-			return 0;
-	}
-	else
-	{
-		if (POOL_GET_BIT(tree, pos))
-		{
-			res = find_pos(tree, max_level, 2 * pos, depth);
-			if (res)
-				return res;
-			res = find_pos(tree, max_level, pos * 2 + 1, depth);
-			if (res)
-				return res;
-		}
-		return 0;
+			value = left > right ? left : right;
+		if (TREE(p)[pos] == value)
+			break;
+		TREE(p)[pos] = value;
 	}
 }
 
+/**
+	@fn void pool_buddy_init(pool_buddy* p, void* mem, pool_size size, pool_size block_size, void* meta, pool_err* err)
+	@brief Initializes the structure
+
+	size and block_size must be powers of 2.
+
+	@param[out] p The buddy struct
+	@param[in] mem The memory base
+	@param[in] size The size of the memory
+	@param[in] block_size The size of a block
+	@param[in] meta The metadata storage (POOL_BUDDY_META_SIZE(size, block_size) bytes)
+	@param[out] err The error that happened
+*/
+POOL_FUNC void pool_buddy_init(pool_buddy* p, void* mem, pool_size size, pool_size block_size, void* meta, pool_err* err)
+{
+	pool_u i;
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(p == NULL, err, POOL_ERR_INVALID_POOL, );
+	POOL_SET_ERR_IF(mem == NULL || meta == NULL, err, POOL_ERR_INVALID_PTR, );
+	POOL_SET_ERR_IF(!POOL_IS_POW2(size) || !POOL_IS_POW2(block_size) || block_size > size, err, POOL_ERR_INVALID_SIZE, );
+	POOL_SET_ERR_IF(pool_log2(size / block_size) >= POOL_BUDDY_ORDER_MAX, err, POOL_ERR_INVALID_SIZE, );
+	p->tree_offset = (pool_u)meta - (pool_u)p;
+	p->mem_offset = (pool_u)mem - (pool_u)p;
+	p->allocated = 0;
+	p->depth = (pool_u8)pool_log2(size / block_size);
+	p->block_shift = (pool_u8)pool_log2(block_size);
+#ifdef POOL_CONCURRENT
+	p->lock = 0;
+#endif
+
+	TREE(p)[0] = 0;
+	for (i = 1; i < BLOCK_N(p); i++)
+		TREE(p)[i] = (pool_u8)(p->depth - pool_log2(i) + 1);
+	for (i = 0; i < POOL_CEIL_DIV(BLOCK_N(p), 8); i++)
+		LEAVES(p)[i] = 0xff;
+}
+
 /**
 	@fn void* pool_buddy_malloc(pool_buddy* p, pool_size size, pool_err* err)
 	@brief Allocates size bytes in the memory
@@ -99,32 +135,72 @@ POOL_FUNC static pool_u find_pos(pool_u8* tree, pool_u8 max_level, pool_u pos, p
 */
 POOL_FUNC void* pool_buddy_malloc(pool_buddy* p, pool_size size, pool_err* err)
 {
-	pool_u max_level;
-	pool_u pos;
-	pool_u pos_level;
-	pool_u8 depth = pool_log2(POOL_CEIL_DIV(POOL_BUDDY_MAX_SIZE, POOL_BUDDY_BLOCK_SIZE));
+	pool_u8 order;
+	pool_u8 level;
+	pool_u8 left, right;
+	pool_u pos = 1;
 	POOL_SET_ERR(err, POOL_ERR_OK);
 	POOL_SET_ERR_IF(p == NULL, err, POOL_ERR_INVALID_POOL, NULL);
 	POOL_SET_ERR_IF(size == 0, err, POOL_ERR_INVALID_SIZE, NULL);
-	POOL_SET_ERR_IF(size > POOL_BUDDY_MAX_SIZE, err, POOL_ERR_OUT_OF_MEM, NULL);
+	POOL_SET_ERR_IF(size > (pool_size)BLOCK_N(p) << p->block_shift, err, POOL_ERR_OUT_OF_MEM, NULL);
 
-	if (size < POOL_BUDDY_BLOCK_SIZE)
-		size = POOL_BUDDY_BLOCK_SIZE;
+	order = pool_buddy_order(p, size);
+	POOL_SET_ERR_IF(node_value(p, 1) <= order, err, POOL_ERR_OUT_OF_MEM, NULL);
 
-	max_level = pool_log2(POOL_BUDDY_MAX_SIZE / size);
-	pos = find_pos(p->tree, max_level, 1, depth);
-	POOL_SET_ERR_IF(pos == 0, err, POOL_ERR_OUT_OF_MEM, NULL);
+	// Goes down to the smallest free block that fits
+	for (level = 0; level < p->depth - order; level++)
+	{
+		left = node_value(p, 2 * pos);
+		right = node_value(p, 2 * pos + 1);
+		if (left > order && (right <= order || left <= right))
+			pos = 2 * pos;
+		else
+			pos = 2 * pos + 1;
+	}
 
-	POOL_UST_BIT(p->tree, pos);
+	node_set_used(p, pos);
+	update_parents(p, pos, level);
 
-	pos_level = pool_log2(pos);
+	p->allocated += (pool_u)1 << order;
 
-	for (; pos_level < depth; pos_level++)
-		pos *= 2;
+	return (void*)((((pos << order) - BLOCK_N(p)) << p->block_shift) + MEM(p));
+}
 
-	p->allocated += pool_pow2(depth - max_level);
+/**
+	@fn static pool_u find_node(pool_buddy* p, void* ptr, pool_u8* level)
+	@brief Finds the allocated node of a pointer
 
-	return (void*)((pos - POOL_BUDDY_BLOCK_N)*POOL_BUDDY_BLOCK_SIZE + (char*)p->mem);
+	@param[in] p The buddy struct
+	@param[in] ptr The pointer to the buffer
+	@param[out] level The level of the node
+
+	@return The position of the node in the tree, 0 if ptr is not an allocated buffer
+*/
+POOL_FUNC static pool_u find_node(pool_buddy* p, void* ptr, pool_u8* level)
+{
+	pool_u offset;
+	pool_u pos;
+	if ((char*)ptr < MEM(p) || (char*)ptr >= MEM(p) + (BLOCK_N(p) << p->block_shift))
+		return 0;
+	offset = (pool_u)((char*)ptr - MEM(p));
+	if ((offset & (((pool_u)1 << p->block_shift) - 1)) != 0)
+		return 0;
+	offset >>= p->block_shift;
+
+	// Goes up to the allocated node
+	*level = p->depth;
+	pos = offset + BLOCK_N(p);
+	if (POOL_GET_BIT(LEAVES(p), offset))
+	{
+		do
+		{
+			pos /= 2;
+			(*level)--;
+		} while (pos != 0 && TREE(p)[pos] != POOL_BUDDY_NODE_USED);
+	}
+	if (pos == 0 || (pos << (p->depth - *level)) - BLOCK_N(p) != offset)
+		return 0;
+	return pos;
 }
 
 /**
@@ -137,47 +213,173 @@ POOL_FUNC void* pool_buddy_malloc(pool_buddy* p, pool_size size, pool_err* err)
 */
 POOL_FUNC void pool_buddy_free(pool_buddy* p, void* ptr, pool_err* err)
 {
-	pool_u ptr_pos;
-	pool_u test_pos;
-	pool_u8 depth = pool_log2(POOL_CEIL_DIV(POOL_BUDDY_MAX_SIZE, POOL_BUDDY_BLOCK_SIZE));
+	pool_u pos;
+	pool_u8 level;
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	if (ptr == NULL)
+		return;
+	POOL_SET_ERR_IF(p == NULL, err, POOL_ERR_INVALID_POOL, );
+	pos = find_node(p, ptr, &level);
+	POOL_SET_ERR_IF(pos == 0, err, POOL_ERR_INVALID_PTR, );
+
+	node_set_free(p, pos, level);
+	update_parents(p, pos, level);
+
+	p->allocated -= (pool_u)1 << (p->depth - level);
+}
+
+/**
+	@fn void pool_buddy_free_sized(pool_buddy* p, void* ptr, pool_size size, pool_err* err)
+	@brief Frees a buffer of a known size, its node is computed from the order of the size
+
+	ptr and size are only checked when POOL_DEBUG is defined.
+
+	@param[inout] p The buddy struct
+	@param[in] ptr The pointer to the buffer
+	@param[in] size The size given to malloc
+	@param[out] err The error that happened
+*/
+POOL_FUNC void pool_buddy_free_sized(pool_buddy* p, void* ptr, pool_size size, pool_err* err)
+{
+	pool_u pos;
+	pool_u8 order;
+#ifdef POOL_DEBUG
+	pool_u8 level;
+#endif
 	POOL_SET_ERR(err, POOL_ERR_OK);
 	if (ptr == NULL)
 		return;
 	POOL_SET_ERR_IF(p == NULL, err, POOL_ERR_INVALID_POOL, );
-	POOL_SET_ERR_IF(ptr < p->mem || (char*)ptr > (char*)p->mem + POOL_BUDDY_MAX_SIZE, err, POOL_ERR_INVALID_PTR, );
-
-	ptr_pos = (pool_u)(POOL_CEIL_DIV((char*)ptr - (char*)p->mem, POOL_BUDDY_BLOCK_SIZE) + POOL_BUDDY_BLOCK_N);
-	while (POOL_GET_BIT(p->tree, ptr_pos) && ptr_pos != 0)
-		ptr_pos /= 2;
-	POOL_SET_ERR_IF(ptr_pos == 0, err, POOL_ERR_INVALID_PTR, );
-	test_pos = ptr_pos;
-	for (; pool_log2(test_pos) < depth; test_pos *= 2);
-	void* test_addr = (void*)((test_pos - POOL_BUDDY_BLOCK_N)*POOL_BUDDY_BLOCK_SIZE + (char*)p->mem);
-	POOL_SET_ERR_IF(test_addr != ptr, err, POOL_ERR_INVALID_PTR, );
-	POOL_SET_BIT(p->tree, ptr_pos);
-
-	p->allocated -= pool_pow2(depth - pool_log2(ptr_pos));
+	order = pool_buddy_order(p, size);
+	pos = ((pool_u)((char*)ptr - MEM(p)) >> (p->block_shift + order)) + (BLOCK_N(p) >> order);
+#ifdef POOL_DEBUG
+	POOL_SET_ERR_IF(size == 0 || order > p->depth, err, POOL_ERR_INVALID_SIZE, );
+	POOL_SET_ERR_IF(find_node(p, ptr, &level) != pos, err, POOL_ERR_INVALID_PTR, );
+#endif
+
+	node_set_free(p, pos, p->depth - order);
+	update_parents(p, pos, p->depth - order);
+
+	p->allocated -= (pool_u)1 << order;
 }
 
 /**
-	@fn static pool_u calc_size(pool_u8* tree, pool_u pos, pool_u8 depth)
-	@brief Calculates the number of used blocks in the pool
+	@fn pool_u8 pool_buddy_resize(pool_buddy* p, void* ptr, pool_size size, pool_err* err)
+	@brief Resizes an allocated buffer without moving it
 
-	@param[in] tree The tree
-	@param[in] pos The position in the tree we are looking at
-	@param[in] depth The depth of the tree
+	Grows by merging the free right buddies (ptr must be their left buddy), shrinks by
+	splitting and freeing the right halves.
 
-	@return The number of used blocks
+	@param[inout] p The buddy struct
+	@param[in] ptr The buffer
+	@param[in] size The new size
+	@param[out] err The error that happened
+
+	@return 1 if the buffer now holds size bytes, 0 if it cannot grow in place
 */
-POOL_FUNC static pool_u calc_size(pool_u8* tree, pool_u pos, pool_u8 depth)
+POOL_FUNC pool_u8 pool_buddy_resize(pool_buddy* p, void* ptr, pool_size size, pool_err* err)
 {
-	pool_u8 pos_level = pool_log2(pos);
-	if (pos_level > depth)
+	pool_u pos, up;
+	pool_u8 level, order, target, i;
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(p == NULL, err, POOL_ERR_INVALID_POOL, 0);
+	POOL_SET_ERR_IF(size == 0, err, POOL_ERR_INVALID_SIZE, 0);
+	pos = find_node(p, ptr, &level);
+	POOL_SET_ERR_IF(pos == 0, err, POOL_ERR_INVALID_PTR, 0);
+	if (size > (pool_size)BLOCK_N(p) << p->block_shift)
 		return 0;
-	if (!POOL_GET_BIT(tree, pos))
-		return pool_pow2(depth - pos_level);
+	order = p->depth - level;
+	target = pool_buddy_order(p, size);
+	if (target == order)
+		return 1;
+
+	if (target > order)
+	{
+		// Every right buddy up to the target order must be free
+		up = pos;
+		for (i = order; i < target; i++, up /= 2)
+		{
+			if ((up & 1) != 0 || node_value(p, up + 1) != i + 1)
+				return 0;
+		}
+		node_set_free(p, pos, level);
+		update_parents(p, pos, level);
+		node_set_used(p, up);
+		update_parents(p, up, level - (target - order));
+		p->allocated += ((pool_u)1 << target) - ((pool_u)1 << order);
+	}
 	else
-		return calc_size(tree, 2 * pos, depth) + calc_size(tree, 2 * pos + 1, depth);
+	{
+		// The left descendant keeps the buffer, the right halves were already marked free under the used node
+		up = pos << (order - target);
+		node_set_used(p, up);
+		update_parents(p, up, level + (order - target));
+		p->allocated -= ((pool_u)1 << order) - ((pool_u)1 << target);
+	}
+	return 1;
+}
+
+/**
+	@fn pool_u8 pool_buddy_block_order(pool_buddy* p, void* ptr, pool_err* err)
+	@brief Finds the order of an allocated buffer
+
+	Only reads the tree nodes covering ptr, which are not modified while ptr is allocated.
+
+	@param[in] p The buddy struct
+	@param[in] ptr The pointer to the buffer
+	@param[out] err The error that happened
+
+	@return The order of the buffer
+*/
+POOL_FUNC pool_u8 pool_buddy_block_order(pool_buddy* p, void* ptr, pool_err* err)
+{
+	pool_u8 level;
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(p == NULL, err, POOL_ERR_INVALID_POOL, POOL_BUDDY_ORDER_NONE);
+	POOL_SET_ERR_IF(find_node(p, ptr, &level) == 0, err, POOL_ERR_INVALID_PTR, POOL_BUDDY_ORDER_NONE);
+	return p->depth - level;
+}
+
+/**
+	@fn void pool_buddy_free_blocks(pool_buddy* p, pool_u* counts, pool_err* err)
+	@brief Counts the free blocks of each order
+
+	A free block is counted once at its largest order (not as its halves). Walks the nodes
+	above the allocated blocks, the whole subtrees that are free or used are skipped.
+
+	@param[in] p The buddy struct
+	@param[inout] counts The counts indexed by order (POOL_BUDDY_ORDER_MAX), incremented
+	@param[out] err The error that happened
+*/
+POOL_FUNC void pool_buddy_free_blocks(pool_buddy* p, pool_u* counts, pool_err* err)
+{
+	pool_u pos = 1;
+	pool_u8 level = 0;
+	pool_u8 value;
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(p == NULL, err, POOL_ERR_INVALID_POOL, );
+	POOL_SET_ERR_IF(counts == NULL, err, POOL_ERR_INVALID_PTR, );
+	while (pos != 0)
+	{
+		// Goes down while the node is partly free
+		value = node_value(p, pos);
+		if (value != 0 && value != p->depth - level + 1 && level < p->depth)
+		{
+			pos = 2 * pos;
+			level++;
+			continue;
+		}
+		if (value == p->depth - level + 1)
+			counts[p->depth - level]++;
+		// Next node: the right sibling of the first left ancestor
+		while ((pos & 1) != 0)
+		{
+			pos /= 2;
+			level--;
+		}
+		if (pos != 0)
+			pos++;
+	}
 }
 
 /**
@@ -190,30 +392,62 @@ POOL_FUNC static pool_u calc_size(pool_u8* tree, pool_u pos, pool_u8 depth)
 */
 POOL_FUNC void pool_buddy_stat(pool_buddy* p, pool_buddy_stats* stats, pool_err* err)
 {
-	pool_u8 depth = pool_log2(POOL_CEIL_DIV(POOL_BUDDY_MAX_SIZE, POOL_BUDDY_BLOCK_SIZE));
 	POOL_SET_ERR(err, POOL_ERR_OK);
 	POOL_SET_ERR_IF(p == NULL, err, POOL_ERR_INVALID_POOL, );
 	POOL_SET_ERR_IF(stats == NULL, err, POOL_ERR_INVALID_PTR, );
-	stats->size = POOL_BUDDY_MAX_SIZE;
-	stats->n_blocks = POOL_BUDDY_BLOCK_N;
-	stats->n_blocks_used = calc_size(p->tree, 1, depth);
-	stats->used = stats->n_blocks_used*POOL_BUDDY_BLOCK_SIZE;
+	stats->size = (pool_size)BLOCK_N(p) << p->block_shift;
+	stats->n_blocks = BLOCK_N(p);
+	stats->n_blocks_used = p->allocated;
+	stats->used = (pool_size)stats->n_blocks_used << p->block_shift;
 }
 
 /**
-@fn static pool_u pool_buddy_size(pool_u8* tree, pool_u pos, pool_u8 depth)
-@brief Calculates the number of allocated bytes in the pool
+@fn pool_u pool_buddy_size(pool_buddy* p, pool_err* err)
+@brief Gives the number of allocated bytes in the pool (from the allocated counter)
 
-@param[in] tree The tree
-@param[in] pos The position in the tree we are looking at
-@param[in] depth The depth of the tree
+@param[in] p The buddy struct
+@param[out] err The error that happened
 
 @return The number of allocated bytes
 */
 POOL_FUNC pool_u pool_buddy_size(pool_buddy* p, pool_err* err)
 {
-	pool_u8 depth = pool_log2(POOL_CEIL_DIV(POOL_BUDDY_MAX_SIZE, POOL_BUDDY_BLOCK_SIZE));
 	POOL_SET_ERR(err, POOL_ERR_OK);
 	POOL_SET_ERR_IF(p == NULL, err, POOL_ERR_INVALID_POOL, 0);
-	return POOL_BUDDY_BLOCK_SIZE*calc_size(p->tree, 1, depth);
+	return (pool_size)p->allocated << p->block_shift;
 }
+
+/**
+	@fn pool_u8 pool_buddy_order(pool_buddy* p, pool_size size)
+	@brief Calculates the order of the smallest block that can hold size bytes
+
+	@param[in] p The buddy struct
+	@param[in] size The number of bytes
+
+	@return The order of the block
+*/
+POOL_FUNC pool_u8 pool_buddy_order(pool_buddy* p, pool_size size)
+{
+	pool_size n = (size + ((pool_size)1 << p->block_shift) - 1) >> p->block_shift;
+	if (n <= 1)
+		return 0;
+	return (pool_u8)(pool_log2(n - 1) + 1);
+}
+
+/**
+	@fn pool_u8 pool_buddy_max_order(pool_buddy* p, pool_err* err)
+	@brief Calculates the order of the largest free block
+
+	@param[in] p The buddy struct
+	@param[out] err The error that happened
+
+	@return The order of the largest free block, POOL_BUDDY_ORDER_NONE if the buddy is full
+*/
+POOL_FUNC pool_u8 pool_buddy_max_order(pool_buddy* p, pool_err* err)
+{
+	pool_u8 value;
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(p == NULL, err, POOL_ERR_INVALID_POOL, POOL_BUDDY_ORDER_NONE);
+	value = node_value(p, 1);
+	return value ? value - 1 : POOL_BUDDY_ORDER_NONE;
+}
\ No newline at end of file
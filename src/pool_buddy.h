@@ -3,19 +3,30 @@
 #define BUDDY_H_INCLUDED
 
 #include "pool_defs.h"
+#include "pool_atomic.h"
 /**
 @defgroup BUDDY Buddy memory pool
 @{
 */
 
-/** Size of a buddy memory */
+/** Default size of a buddy memory */
 #define POOL_BUDDY_MAX_SIZE POOL_PAGE_SIZE
-/** Size of a buddy block */
+/** Default size of a buddy block */
 #define POOL_BUDDY_BLOCK_SIZE POOL_BLOCK_SIZE
-/** Number of blocks in the memory */
+/** Default number of blocks in the memory */
 #define POOL_BUDDY_BLOCK_N (POOL_PAGE_SIZE / POOL_BLOCK_SIZE)
-/** Size of the buddy tree */
-#define POOL_BUDDY_TREE_SIZE (POOL_CEIL_DIV(POOL_BUDDY_BLOCK_N, 4))
+/** Default depth of the buddy tree */
+#define POOL_BUDDY_DEPTH POOL_LOG2_CONST(POOL_BUDDY_BLOCK_N)
+/** Default number of orders (a block of order n is 2^n blocks) */
+#define POOL_BUDDY_ORDER_N (POOL_BUDDY_DEPTH + 1)
+/** Maximum number of orders of any geometry */
+#define POOL_BUDDY_ORDER_MAX 32
+/** Value of an inner node that is allocated as a whole */
+#define POOL_BUDDY_NODE_USED 0xff
+/** No free block of any order */
+#define POOL_BUDDY_ORDER_NONE 0xff
+/** Size of the metadata of a buddy memory (1 byte per inner node, 1 bit per block) */
+#define POOL_BUDDY_META_SIZE(size, block_size) ((size) / (block_size) + POOL_CEIL_DIV((size) / (block_size), 8))
 
 /**
 	@struct _pool_buddy
@@ -23,12 +34,20 @@
 */
 typedef struct _pool_buddy
 {
-	/** The buddy tree */
-	pool_u8 tree[POOL_BUDDY_TREE_SIZE];
-	/** The memory base */
-	void* mem;
+	/** Offset of the buddy tree from the buddy struct, for each inner node the order of the largest free block under it + 1 (0 if none), followed by the leaves (1 bit per block, 1 if free) */
+	pool_u tree_offset;
+	/** Offset of the memory base from the buddy struct, so a buddy mapped at another address with its memory stays valid */
+	pool_u mem_offset;
 	/** The number of block allocated */
 	pool_u allocated;
+	/** The depth of the tree (the memory has 2^depth blocks) */
+	pool_u8 depth;
+	/** Log 2 of the block size */
+	pool_u8 block_shift;
+#ifdef POOL_CONCURRENT
+	/** Guards the buddy when it is a page of a concurrent slab pool */
+	pool_lock lock;
+#endif
 } pool_buddy;
 
 /**
@@ -48,14 +67,19 @@ typedef struct _pool_buddy_stats
 } pool_buddy_stats;
 
 /**
-	@fn void pool_buddy_init(pool_buddy* p, void* mem, pool_err* err)
+	@fn void pool_buddy_init(pool_buddy* p, void* mem, pool_size size, pool_size block_size, void* meta, pool_err* err)
 	@brief Initializes the structure
 
+	size and block_size must be powers of 2.
+
 	@param[out] p The buddy struct
 	@param[in] mem The memory base
+	@param[in] size The size of the memory
+	@param[in] block_size The size of a block
+	@param[in] meta The metadata storage (POOL_BUDDY_META_SIZE(size, block_size) bytes)
 	@param[out] err The error that happened
 */
-POOL_FUNC void pool_buddy_init(pool_buddy* p, void* mem, pool_err* err);
+POOL_FUNC void pool_buddy_init(pool_buddy* p, void* mem, pool_size size, pool_size block_size, void* meta, pool_err* err);
 
 /**
 	@fn void* pool_buddy_malloc(pool_buddy* p, pool_size size, pool_err* err)
@@ -79,6 +103,49 @@ POOL_FUNC void* pool_buddy_malloc(pool_buddy* p, pool_size size, pool_err* err);
 */
 POOL_FUNC void pool_buddy_free(pool_buddy* p, void* ptr, pool_err* err);
 
+/**
+	@fn void pool_buddy_free_sized(pool_buddy* p, void* ptr, pool_size size, pool_err* err)
+	@brief Frees a buffer of a known size, its node is computed from the order of the size
+
+	ptr and size are only checked when POOL_DEBUG is defined.
+
+	@param[inout] p The buddy struct
+	@param[in] ptr The pointer to the buffer
+	@param[in] size The size given to malloc
+	@param[out] err The error that happened
+*/
+POOL_FUNC void pool_buddy_free_sized(pool_buddy* p, void* ptr, pool_size size, pool_err* err);
+
+/**
+	@fn pool_u8 pool_buddy_resize(pool_buddy* p, void* ptr, pool_size size, pool_err* err)
+	@brief Resizes an allocated buffer without moving it
+
+	Grows by merging the free right buddies (ptr must be their left buddy), shrinks by
+	splitting and freeing the right halves.
+
+	@param[inout] p The buddy struct
+	@param[in] ptr The buffer
+	@param[in] size The new size
+	@param[out] err The error that happened
+
+	@return 1 if the buffer now holds size bytes, 0 if it cannot grow in place
+*/
+POOL_FUNC pool_u8 pool_buddy_resize(pool_buddy* p, void* ptr, pool_size size, pool_err* err);
+
+/**
+	@fn pool_u8 pool_buddy_block_order(pool_buddy* p, void* ptr, pool_err* err)
+	@brief Finds the order of an allocated buffer
+
+	Only reads the tree nodes covering ptr, which are not modified while ptr is allocated.
+
+	@param[in] p The buddy struct
+	@param[in] ptr The pointer to the buffer
+	@param[out] err The error that happened
+
+	@return The order of the buffer
+*/
+POOL_FUNC pool_u8 pool_buddy_block_order(pool_buddy* p, void* ptr, pool_err* err);
+
 /**
 	@fn void pool_buddy_stat(pool_buddy* p, pool_buddy_stats* stats, pool_err* err);
 	@brief Stats the buddy mem
@@ -90,12 +157,46 @@ POOL_FUNC void pool_buddy_free(pool_buddy* p, void* ptr, pool_err* err);
 POOL_FUNC void pool_buddy_stat(pool_buddy* p, pool_buddy_stats* stats, pool_err* err);
 
 /**
-	@fn static pool_u pool_buddy_size(pool_u8* tree, pool_u pos, pool_u8 depth)
-	@brief Calculates the number of allocated bytes in the pool
+	@fn pool_u8 pool_buddy_order(pool_buddy* p, pool_size size)
+	@brief Calculates the order of the smallest block that can hold size bytes
+
+	@param[in] p The buddy struct
+	@param[in] size The number of bytes
+
+	@return The order of the block
+*/
+POOL_FUNC pool_u8 pool_buddy_order(pool_buddy* p, pool_size size);
+
+/**
+	@fn pool_u8 pool_buddy_max_order(pool_buddy* p, pool_err* err)
+	@brief Calculates the order of the largest free block
+
+	@param[in] p The buddy struct
+	@param[out] err The error that happened
+
+	@return The order of the largest free block, POOL_BUDDY_ORDER_NONE if the buddy is full
+*/
+POOL_FUNC pool_u8 pool_buddy_max_order(pool_buddy* p, pool_err* err);
+
+/**
+	@fn void pool_buddy_free_blocks(pool_buddy* p, pool_u* counts, pool_err* err)
+	@brief Counts the free blocks of each order
+
+	A free block is counted once at its largest order (not as its halves). Walks the nodes
+	above the allocated blocks, the whole subtrees that are free or used are skipped.
+
+	@param[in] p The buddy struct
+	@param[inout] counts The counts indexed by order (POOL_BUDDY_ORDER_MAX), incremented
+	@param[out] err The error that happened
+*/
+POOL_FUNC void pool_buddy_free_blocks(pool_buddy* p, pool_u* counts, pool_err* err);
+
+/**
+	@fn pool_u pool_buddy_size(pool_buddy* p, pool_err* err)
+	@brief Gives the number of allocated bytes in the pool (from the allocated counter)
 
-	@param[in] tree The tree
-	@param[in] pos The position in the tree we are looking at
-	@param[in] depth The depth of the tree
+	@param[in] p The buddy struct
+	@param[out] err The error that happened
 
 	@return The number of allocated bytes
 */
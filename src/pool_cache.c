@@ -0,0 +1,179 @@
+#include "pool_cache.h"
+
+/** Bytes kept at the start of a page to link the pages */
+#define PAGE_HEADER sizeof(void*)
+
+/**
+	@fn static void* refill(pool_cache* c, pool_err* err)
+	@brief Takes a page from the pool and links its slots, except the first one which is returned
+
+	@param[inout] c The object cache
+	@param[out] err The error that happened
+
+	@return The first slot of the page
+*/
+POOL_FUNC static void* refill(pool_cache* c, pool_err* err)
+{
+	char* page = pool_slab_malloc(c->pool, c->pool->page_size, err);
+	char* slot;
+	pool_u i;
+	if (page == NULL)
+		return NULL;
+	*(void**)page = c->pages;
+	c->pages = page;
+	c->page_n++;
+	slot = page + PAGE_HEADER;
+	for (i = 1; i < c->per_page; i++)
+	{
+		*(void**)(slot + i * c->obj_size) = c->free;
+		c->free = slot + i * c->obj_size;
+	}
+	return slot;
+}
+
+/**
+	@fn void pool_cache_init(pool_cache* c, pool_slab* pool, pool_size obj_size, pool_err* err)
+	@brief Initializes an object cache, no page is taken until the first allocation
+
+	@param[out] c The object cache
+	@param[in] pool The pool that gives the pages
+	@param[in] obj_size The size of an object (rounded up to the size of a pointer)
+	@param[out] err The error that happened
+*/
+POOL_FUNC void pool_cache_init(pool_cache* c, pool_slab* pool, pool_size obj_size, pool_err* err)
+{
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(c == NULL || pool == NULL, err, POOL_ERR_INVALID_POOL, );
+	obj_size = obj_size < sizeof(void*) ? sizeof(void*) : POOL_ALIGN_UP(obj_size, sizeof(void*));
+	POOL_SET_ERR_IF(obj_size > pool->page_size - PAGE_HEADER, err, POOL_ERR_INVALID_SIZE, );
+	c->pool = pool;
+	c->free = NULL;
+	c->pages = NULL;
+	c->obj_size = obj_size;
+	c->per_page = (pool->page_size - PAGE_HEADER) / obj_size;
+	c->page_n = 0;
+	c->used = 0;
+#ifdef POOL_CONCURRENT
+	c->lock = 0;
+#endif
+}
+
+/**
+	@fn void* pool_cache_malloc(pool_cache* c, pool_err* err)
+	@brief Allocates an object, takes a page from the pool if no slot is free
+
+	@param[inout] c The object cache
+	@param[out] err The error that happened
+
+	@return The object
+*/
+POOL_FUNC void* pool_cache_malloc(pool_cache* c, pool_err* err)
+{
+	void* ret;
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(c == NULL, err, POOL_ERR_INVALID_POOL, NULL);
+	POOL_LOCK_ACQUIRE(&c->lock);
+	ret = c->free;
+	if (ret != NULL)
+		c->free = *(void**)ret;
+	else
+		ret = refill(c, err);
+	if (ret != NULL)
+		c->used++;
+	POOL_LOCK_RELEASE(&c->lock);
+	return ret;
+}
+
+/**
+	@fn void pool_cache_free(pool_cache* c, void* ptr, pool_err* err)
+	@brief Gives an object back to the cache, the page stays in the cache
+
+	@param[inout] c The object cache
+	@param[in] ptr The object
+	@param[out] err The error that happened
+*/
+POOL_FUNC void pool_cache_free(pool_cache* c, void* ptr, pool_err* err)
+{
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	if (ptr == NULL)
+		return;
+	POOL_SET_ERR_IF(c == NULL, err, POOL_ERR_INVALID_POOL, );
+	POOL_LOCK_ACQUIRE(&c->lock);
+	*(void**)ptr = c->free;
+	c->free = ptr;
+	c->used--;
+	POOL_LOCK_RELEASE(&c->lock);
+}
+
+/**
+	@fn void pool_cache_free_batch(pool_cache* c, void** ptrs, pool_u n, pool_err* err)
+	@brief Gives n objects back to the cache under one lock
+
+	@param[inout] c The object cache
+	@param[in] ptrs The objects (NULL entries are skipped)
+	@param[in] n The number of objects
+	@param[out] err The error that happened
+*/
+POOL_FUNC void pool_cache_free_batch(pool_cache* c, void** ptrs, pool_u n, pool_err* err)
+{
+	pool_u i;
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(c == NULL, err, POOL_ERR_INVALID_POOL, );
+	POOL_SET_ERR_IF(ptrs == NULL && n != 0, err, POOL_ERR_INVALID_PTR, );
+	POOL_LOCK_ACQUIRE(&c->lock);
+	for (i = 0; i < n; i++)
+	{
+		if (ptrs[i] == NULL)
+			continue;
+		*(void**)ptrs[i] = c->free;
+		c->free = ptrs[i];
+		c->used--;
+	}
+	POOL_LOCK_RELEASE(&c->lock);
+}
+
+/**
+	@fn void pool_cache_destroy(pool_cache* c, pool_err* err)
+	@brief Gives all the pages back to the pool, the live objects are lost
+
+	@param[inout] c The object cache
+	@param[out] err The error that happened
+*/
+POOL_FUNC void pool_cache_destroy(pool_cache* c, pool_err* err)
+{
+	void* page;
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(c == NULL, err, POOL_ERR_INVALID_POOL, );
+	POOL_LOCK_ACQUIRE(&c->lock);
+	while (c->pages != NULL)
+	{
+		page = c->pages;
+		c->pages = *(void**)page;
+		pool_slab_free(c->pool, page, NULL);
+	}
+	c->free = NULL;
+	c->page_n = 0;
+	c->used = 0;
+	POOL_LOCK_RELEASE(&c->lock);
+}
+
+/**
+	@fn void pool_cache_stat(pool_cache* c, pool_cache_stats* stats, pool_err* err)
+	@brief Stats the object cache
+
+	@param[in] c The object cache
+	@param[out] stats The statistics
+	@param[out] err The error that happened
+*/
+POOL_FUNC void pool_cache_stat(pool_cache* c, pool_cache_stats* stats, pool_err* err)
+{
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(c == NULL, err, POOL_ERR_INVALID_POOL, );
+	POOL_SET_ERR_IF(stats == NULL, err, POOL_ERR_INVALID_PTR, );
+	POOL_LOCK_ACQUIRE(&c->lock);
+	stats->pages = c->page_n;
+	stats->per_page = c->per_page;
+	stats->used = c->used;
+	stats->free = c->page_n * c->per_page - c->used;
+	POOL_LOCK_RELEASE(&c->lock);
+}
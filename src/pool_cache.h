@@ -0,0 +1,119 @@
+/** @file */
+#ifndef POOL_CACHE_H_INCLUDED
+#define POOL_CACHE_H_INCLUDED
+
+#include "pool_slab.h"
+
+/**
+@defgroup CACHE Object cache
+A cache of objects of one size, carved from whole pages of a slab pool
+@{
+*/
+
+/**
+	@struct _pool_cache_stats
+	@brief Statistics about an object cache
+*/
+typedef struct _pool_cache_stats
+{
+	/** Number of pages taken from the pool */
+	pool_u pages;
+	/** Number of slots per page */
+	pool_u per_page;
+	/** Number of live objects */
+	pool_u used;
+	/** Number of free slots */
+	pool_u free;
+} pool_cache_stats;
+
+/**
+	@struct _pool_cache
+	@brief An object cache, the free slots are linked through their first bytes
+*/
+typedef struct _pool_cache
+{
+	/** The pool that gives the pages */
+	pool_slab* pool;
+	/** The first free slot (NULL if none) */
+	void* free;
+	/** The pages taken from the pool, linked through their first bytes */
+	void* pages;
+	/** The size of a slot */
+	pool_size obj_size;
+	/** Number of slots per page */
+	pool_u per_page;
+	/** Number of pages taken from the pool */
+	pool_u page_n;
+	/** Number of live objects */
+	pool_u used;
+#ifdef POOL_CONCURRENT
+	/** Lock of the free list */
+	pool_lock lock;
+#endif
+} pool_cache;
+
+/**
+	@fn void pool_cache_init(pool_cache* c, pool_slab* pool, pool_size obj_size, pool_err* err)
+	@brief Initializes an object cache, no page is taken until the first allocation
+
+	@param[out] c The object cache
+	@param[in] pool The pool that gives the pages
+	@param[in] obj_size The size of an object (rounded up to the size of a pointer)
+	@param[out] err The error that happened
+*/
+POOL_FUNC void pool_cache_init(pool_cache* c, pool_slab* pool, pool_size obj_size, pool_err* err);
+
+/**
+	@fn void* pool_cache_malloc(pool_cache* c, pool_err* err)
+	@brief Allocates an object, takes a page from the pool if no slot is free
+
+	@param[inout] c The object cache
+	@param[out] err The error that happened
+
+	@return The object
+*/
+POOL_FUNC void* pool_cache_malloc(pool_cache* c, pool_err* err);
+
+/**
+	@fn void pool_cache_free(pool_cache* c, void* ptr, pool_err* err)
+	@brief Gives an object back to the cache, the page stays in the cache
+
+	@param[inout] c The object cache
+	@param[in] ptr The object
+	@param[out] err The error that happened
+*/
+POOL_FUNC void pool_cache_free(pool_cache* c, void* ptr, pool_err* err);
+
+/**
+	@fn void pool_cache_free_batch(pool_cache* c, void** ptrs, pool_u n, pool_err* err)
+	@brief Gives n objects back to the cache under one lock
+
+	@param[inout] c The object cache
+	@param[in] ptrs The objects (NULL entries are skipped)
+	@param[in] n The number of objects
+	@param[out] err The error that happened
+*/
+POOL_FUNC void pool_cache_free_batch(pool_cache* c, void** ptrs, pool_u n, pool_err* err);
+
+/**
+	@fn void pool_cache_destroy(pool_cache* c, pool_err* err)
+	@brief Gives all the pages back to the pool, the live objects are lost
+
+	@param[inout] c The object cache
+	@param[out] err The error that happened
+*/
+POOL_FUNC void pool_cache_destroy(pool_cache* c, pool_err* err);
+
+/**
+	@fn void pool_cache_stat(pool_cache* c, pool_cache_stats* stats, pool_err* err)
+	@brief Stats the object cache
+
+	@param[in] c The object cache
+	@param[out] stats The statistics
+	@param[out] err The error that happened
+*/
+POOL_FUNC void pool_cache_stat(pool_cache* c, pool_cache_stats* stats, pool_err* err);
+
+/** @} */
+
+#endif
@@ -81,3 +81,46 @@ POOL_FUNC pool_u pool_pow2(pool_u n)
 {
 	return 1 << n;
 }
+
+
+/**
+	@fn pool_u pool_ctz(pool_u n)
+	@brief Counts the trailing zeros of an int (portable version)
+
+	@param n An integer (not 0)
+
+	@return The number of trailing zeros
+*/
+POOL_FUNC pool_u pool_ctz(pool_u n)
+{
+	return pool_log2(n & (~n + 1));
+}
+
+/**
+	@fn pool_u pool_clz(pool_u n)
+	@brief Counts the leading zeros of an int (portable version)
+
+	@param n An integer (not 0)
+
+	@return The number of leading zeros
+*/
+POOL_FUNC pool_u pool_clz(pool_u n)
+{
+	return POOL_U_BITS - 1 - pool_log2(n);
+}
+
+/**
+	@fn pool_u pool_popcount(pool_u n)
+	@brief Counts the bits set in an int (portable version)
+
+	@param n An integer
+
+	@return The number of bits set
+*/
+POOL_FUNC pool_u pool_popcount(pool_u n)
+{
+	n = n - ((n >> 1) & (pool_u)0x5555555555555555ull);
+	n = (n & (pool_u)0x3333333333333333ull) + ((n >> 2) & (pool_u)0x3333333333333333ull);
+	n = (n + (n >> 4)) & (pool_u)0x0f0f0f0f0f0f0f0full;
+	return (pool_u)(n * (pool_u)0x0101010101010101ull) >> (POOL_U_BITS - 8);
+}
\ No newline at end of file
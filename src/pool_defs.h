@@ -14,6 +14,10 @@
 
 /** 8 bits unsigned type */
 typedef unsigned char pool_u8;
+/** 32 bits unsigned type (fixed size fields) */
+typedef unsigned int pool_u32;
+/** 64 bits unsigned type (fixed size fields) */
+typedef unsigned long long int pool_u64;
 
 /** Error type */
 typedef pool_u8 pool_err;
@@ -46,6 +50,28 @@ typedef pool_u pool_size;
 
 /** Divides and ceil the result */
 #define POOL_CEIL_DIV(a, b) (((a) + (b) - 1) / (b))
+/** Rounds a up to a multiple of b */
+#define POOL_ALIGN_UP(a, b) (POOL_CEIL_DIV(a, b) * (b))
+/** Checks if n is a power of 2 */
+#define POOL_IS_POW2(n) ((n) != 0 && ((n) & ((n) - 1)) == 0)
+/** Offset of a member in a struct (offsetof without stddef.h) */
+#define POOL_OFFSET_OF(type, member) ((pool_size)((char*)&((type*)0)->member - (char*)0))
+
+/**
+@defgroup LOG2_CONST Constant log base 2
+@{
+*/
+/** Log 2 of a 2 bits constant */
+#define POOL_LOG2_CONST_2(n) ((n) >= 0x2 ? 1 : 0)
+/** Log 2 of a 4 bits constant */
+#define POOL_LOG2_CONST_4(n) ((n) >= 0x4 ? 2 + POOL_LOG2_CONST_2((n) >> 2) : POOL_LOG2_CONST_2(n))
+/** Log 2 of a 8 bits constant */
+#define POOL_LOG2_CONST_8(n) ((n) >= 0x10 ? 4 + POOL_LOG2_CONST_4((n) >> 4) : POOL_LOG2_CONST_4(n))
+/** Log 2 of a 16 bits constant */
+#define POOL_LOG2_CONST_16(n) ((n) >= 0x100 ? 8 + POOL_LOG2_CONST_8((n) >> 8) : POOL_LOG2_CONST_8(n))
+/** Log 2 of a 32 bits constant, usable in constant expressions (array sizes) */
+#define POOL_LOG2_CONST(n) ((n) >= 0x10000 ? 16 + POOL_LOG2_CONST_16((n) >> 16) : POOL_LOG2_CONST_16(n))
+/** @} */
 
 /** 
 	@defgroup ERRORS Error types
@@ -61,6 +87,8 @@ typedef pool_u pool_size;
 #define POOL_ERR_INVALID_PTR 3
 /** Invalid size */
 #define POOL_ERR_INVALID_SIZE 4
+/** Input or output failed */
+#define POOL_ERR_IO 5
 /** @} */
 
 /**
@@ -114,4 +142,65 @@ POOL_FUNC pool_u pool_log2(pool_u n);
 POOL_FUNC pool_u pool_pow2(pool_u n);
 /** @} */
 
+/**
+@defgroup BIT_COUNT Bit counting
+@{
+*/
+/** Number of bits in a pool_u */
+#define POOL_U_BITS (sizeof(pool_u) * 8)
+
+/**
+	@fn pool_u pool_ctz(pool_u n)
+	@brief Counts the trailing zeros of an int (portable version)
+
+	@param n An integer (not 0)
+
+	@return The number of trailing zeros
+*/
+POOL_FUNC pool_u pool_ctz(pool_u n);
+
+/**
+	@fn pool_u pool_clz(pool_u n)
+	@brief Counts the leading zeros of an int (portable version)
+
+	@param n An integer (not 0)
+
+	@return The number of leading zeros
+*/
+POOL_FUNC pool_u pool_clz(pool_u n);
+
+/**
+	@fn pool_u pool_popcount(pool_u n)
+	@brief Counts the bits set in an int (portable version)
+
+	@param n An integer
+
+	@return The number of bits set
+*/
+POOL_FUNC pool_u pool_popcount(pool_u n);
+
+#if defined(__GNUC__) && (defined(_M_AMD64) || defined(__LP64__))
+/** Counts the trailing zeros (n != 0) */
+#define POOL_CTZ(n) ((pool_u)__builtin_ctzll(n))
+/** Counts the leading zeros (n != 0) */
+#define POOL_CLZ(n) ((pool_u)__builtin_clzll(n))
+/** Counts the bits set */
+#define POOL_POPCOUNT(n) ((pool_u)__builtin_popcountll(n))
+#elif defined(__GNUC__)
+/** Counts the trailing zeros (n != 0) */
+#define POOL_CTZ(n) ((pool_u)__builtin_ctz(n))
+/** Counts the leading zeros (n != 0) */
+#define POOL_CLZ(n) ((pool_u)__builtin_clz(n))
+/** Counts the bits set */
+#define POOL_POPCOUNT(n) ((pool_u)__builtin_popcount(n))
+#else
+/** Counts the trailing zeros (n != 0) */
+#define POOL_CTZ(n) pool_ctz(n)
+/** Counts the leading zeros (n != 0) */
+#define POOL_CLZ(n) pool_clz(n)
+/** Counts the bits set */
+#define POOL_POPCOUNT(n) pool_popcount(n)
+#endif
+/** @} */
+
 #endif
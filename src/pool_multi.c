@@ -0,0 +1,344 @@
+#include "pool_multi.h"
+
+/**
+	@fn static pool_u find_region(pool_multi* p, void* ptr)
+	@brief Finds the region that holds a pointer
+
+	@param[in] p The multi region pool
+	@param[in] ptr The pointer
+
+	@return The index of the region, p->region_n if none
+*/
+POOL_FUNC static pool_u find_region(pool_multi* p, void* ptr)
+{
+	pool_u lo = 0;
+	pool_u hi = p->region_n;
+	pool_u mid;
+	// First region that starts after ptr
+	while (lo < hi)
+	{
+		mid = lo + (hi - lo) / 2;
+		if ((char*)ptr < (char*)p->regions[mid].slab)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+	if (lo == 0 || (char*)ptr >= (char*)p->regions[lo - 1].slab + p->regions[lo - 1].size)
+		return p->region_n;
+	return lo - 1;
+}
+
+/**
+	@fn static pool_u map_region(pool_multi* p, pool_size size, pool_err* err)
+	@brief Maps a new region that can hold an allocation of size bytes
+
+	@param[inout] p The multi region pool
+	@param[in] size The size of the allocation
+	@param[out] err The error that happened
+
+	@return The index of the region, p->region_n if it could not be mapped
+*/
+POOL_FUNC static pool_u map_region(pool_multi* p, pool_size size, pool_err* err)
+{
+	pool_u i;
+	pool_u n_pages;
+	pool_size region_size;
+	void* mem;
+	pool_slab* slab;
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	// The empty regions could not hold the allocation, they are released early to make room
+	if (p->region_n == POOL_MULTI_REGION_MAX)
+		pool_multi_release(p, NULL);
+	POOL_SET_ERR_IF(p->region_n == POOL_MULTI_REGION_MAX, err, POOL_ERR_OUT_OF_MEM, p->region_n);
+
+	// A RAW allocation larger than a region gets a region of its size
+	n_pages = size > p->page_size ? POOL_CEIL_DIV(size, p->page_size) : 1;
+	region_size = POOL_SLAB_CREATE_SIZE(n_pages, p->page_size, p->block_size);
+	if (region_size < p->region_size)
+		region_size = p->region_size;
+
+	mem = p->provider.map(p->provider.data, region_size);
+	POOL_SET_ERR_IF(mem == NULL, err, POOL_ERR_OUT_OF_MEM, p->region_n);
+	slab = pool_slab_create(mem, region_size, p->page_size, p->block_size, err);
+	if (slab == NULL)
+	{
+		p->provider.unmap(p->provider.data, mem, region_size);
+		return p->region_n;
+	}
+	p->maps++;
+
+	// Keeps the regions sorted by address
+	for (i = p->region_n; i > 0 && (char*)p->regions[i - 1].slab > (char*)slab; i--)
+		p->regions[i] = p->regions[i - 1];
+	p->regions[i].slab = slab;
+	p->regions[i].size = region_size;
+	p->regions[i].allocations = 0;
+	p->regions[i].empty_since = POOL_MULTI_NEVER;
+	p->region_n++;
+	return i;
+}
+
+/**
+	@fn static void unmap_region(pool_multi* p, pool_u i)
+	@brief Gives a region back to the provider
+
+	@param[inout] p The multi region pool
+	@param[in] i The index of the region
+*/
+POOL_FUNC static void unmap_region(pool_multi* p, pool_u i)
+{
+	p->provider.unmap(p->provider.data, p->regions[i].slab, p->regions[i].size);
+	p->releases++;
+	p->region_n--;
+	for (; i < p->region_n; i++)
+		p->regions[i] = p->regions[i + 1];
+	if (p->hint >= p->region_n)
+		p->hint = 0;
+}
+
+/**
+	@fn static void release_expired(pool_multi* p)
+	@brief Releases the regions that have been empty for the release delay
+
+	@param[inout] p The multi region pool
+*/
+POOL_FUNC static void release_expired(pool_multi* p)
+{
+	pool_u i;
+	pool_multi_region* r;
+	if (p->ops < p->release_at)
+		return;
+	p->release_at = POOL_MULTI_NEVER;
+	for (i = p->region_n; i > 0; i--)
+	{
+		r = p->regions + i - 1;
+		if (r->empty_since == POOL_MULTI_NEVER)
+			continue;
+		if (p->ops - r->empty_since >= p->release_delay)
+			unmap_region(p, i - 1);
+		else if (r->empty_since + p->release_delay < p->release_at)
+			p->release_at = r->empty_since + p->release_delay;
+	}
+}
+
+/**
+	@fn void pool_multi_init(pool_multi* p, pool_size region_size, pool_size page_size, pool_size block_size, const pool_provider* provider, pool_u release_delay, pool_err* err)
+	@brief Initializes a multi region pool, no region is mapped until the first allocation
+
+	@param[out] p The multi region pool
+	@param[in] region_size The size of a new region (larger allocations get a region of their size)
+	@param[in] page_size The page size of the regions
+	@param[in] block_size The block size of the regions
+	@param[in] provider Gives the memory of the regions
+	@param[in] release_delay The number of operations an empty region is kept (POOL_MULTI_NEVER to keep them)
+	@param[out] err The error that happened
+*/
+POOL_FUNC void pool_multi_init(pool_multi* p, pool_size region_size, pool_size page_size, pool_size block_size, const pool_provider* provider, pool_u release_delay, pool_err* err)
+{
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(p == NULL, err, POOL_ERR_INVALID_POOL, );
+	POOL_SET_ERR_IF(provider == NULL || provider->map == NULL || provider->unmap == NULL, err, POOL_ERR_INVALID_PTR, );
+	POOL_SET_ERR_IF(!POOL_IS_POW2(page_size) || !POOL_IS_POW2(block_size) || block_size > page_size, err, POOL_ERR_INVALID_SIZE, );
+	p->region_n = 0;
+	p->hint = 0;
+	p->region_size = POOL_ALIGN_UP(region_size, page_size);
+	p->page_size = page_size;
+	p->block_size = block_size;
+	p->release_delay = release_delay;
+	p->ops = 0;
+	p->release_at = POOL_MULTI_NEVER;
+	p->provider = *provider;
+	p->maps = 0;
+	p->releases = 0;
+}
+
+/**
+	@fn void* pool_multi_malloc(pool_multi* p, pool_size size, pool_err* err)
+	@brief Allocates size bytes, maps a new region if the others are full
+
+	@param[inout] p The multi region pool
+	@param[in] size The number of bytes to allocate
+	@param[out] err The error that happened
+
+	@return The allocated buffer
+*/
+POOL_FUNC void* pool_multi_malloc(pool_multi* p, pool_size size, pool_err* err)
+{
+	pool_u i;
+	void* ret = NULL;
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(p == NULL, err, POOL_ERR_INVALID_POOL, NULL);
+	POOL_SET_ERR_IF(size == 0, err, POOL_ERR_INVALID_SIZE, NULL);
+	p->ops++;
+
+	// The region of the last allocation first, then the others
+	i = p->hint;
+	if (p->region_n != 0)
+		ret = pool_slab_malloc(p->regions[i].slab, size, NULL);
+	if (ret == NULL)
+	{
+		for (i = 0; i < p->region_n; i++)
+		{
+			if (i != p->hint && (ret = pool_slab_malloc(p->regions[i].slab, size, NULL)) != NULL)
+				break;
+		}
+	}
+	if (ret == NULL)
+	{
+		i = map_region(p, size, err);
+		if (i == p->region_n)
+			return NULL;
+		ret = pool_slab_malloc(p->regions[i].slab, size, err);
+		POOL_SET_ERR_IF(ret == NULL, err, POOL_ERR_OUT_OF_MEM, NULL);
+	}
+
+	p->hint = i;
+	p->regions[i].allocations++;
+	p->regions[i].empty_since = POOL_MULTI_NEVER;
+	release_expired(p);
+	return ret;
+}
+
+/**
+	@fn void pool_multi_free(pool_multi* p, void* ptr, pool_err* err)
+	@brief Frees a buffer in the region that holds it
+
+	@param[inout] p The multi region pool
+	@param[in] ptr The buffer to free
+	@param[out] err The error that happened
+*/
+POOL_FUNC void pool_multi_free(pool_multi* p, void* ptr, pool_err* err)
+{
+	pool_u i;
+	pool_multi_region* r;
+	pool_err err2;
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	if (ptr == NULL)
+		return;
+	POOL_SET_ERR_IF(p == NULL, err, POOL_ERR_INVALID_POOL, );
+	i = find_region(p, ptr);
+	POOL_SET_ERR_IF(i == p->region_n, err, POOL_ERR_INVALID_PTR, );
+	r = p->regions + i;
+	pool_slab_free(r->slab, ptr, &err2);
+	POOL_SET_ERR_IF(err2 != POOL_ERR_OK, err, err2, );
+	p->ops++;
+
+	if (--r->allocations == 0 && p->release_delay != POOL_MULTI_NEVER)
+	{
+		r->empty_since = p->ops;
+		if (p->ops + p->release_delay < p->release_at)
+			p->release_at = p->ops + p->release_delay;
+	}
+	release_expired(p);
+}
+
+/**
+	@fn pool_slab* pool_multi_find(pool_multi* p, void* ptr)
+	@brief Finds the region that holds a pointer (binary search on the addresses)
+
+	@param[in] p The multi region pool
+	@param[in] ptr The pointer
+
+	@return The slab pool of the region, NULL if none
+*/
+POOL_FUNC pool_slab* pool_multi_find(pool_multi* p, void* ptr)
+{
+	pool_u i;
+	if (p == NULL)
+		return NULL;
+	i = find_region(p, ptr);
+	return i == p->region_n ? NULL : p->regions[i].slab;
+}
+
+/**
+	@fn void pool_multi_release(pool_multi* p, pool_err* err)
+	@brief Releases all the empty regions now
+
+	@param[inout] p The multi region pool
+	@param[out] err The error that happened
+*/
+POOL_FUNC void pool_multi_release(pool_multi* p, pool_err* err)
+{
+	pool_u i;
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(p == NULL, err, POOL_ERR_INVALID_POOL, );
+	for (i = p->region_n; i > 0; i--)
+	{
+		if (p->regions[i - 1].allocations == 0)
+			unmap_region(p, i - 1);
+	}
+	p->release_at = POOL_MULTI_NEVER;
+}
+
+/**
+	@fn void pool_multi_destroy(pool_multi* p, pool_err* err)
+	@brief Releases all the regions, even if they are not empty
+
+	@param[inout] p The multi region pool
+	@param[out] err The error that happened
+*/
+POOL_FUNC void pool_multi_destroy(pool_multi* p, pool_err* err)
+{
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(p == NULL, err, POOL_ERR_INVALID_POOL, );
+	while (p->region_n != 0)
+		unmap_region(p, p->region_n - 1);
+	p->release_at = POOL_MULTI_NEVER;
+}
+
+/**
+	@fn pool_u pool_multi_reclaim(pool_multi* p, pool_u delay, pool_u keep, pool_err* err)
+	@brief Gives back the pages of the regions that stayed empty for delay passes with the decommit of the provider
+
+	@param[inout] p The multi region pool
+	@param[in] delay The number of whole passes a page must stay empty (see pool_slab_reclaim)
+	@param[in] keep The number of resident empty pages kept in each region
+	@param[out] err The error that happened (POOL_ERR_INVALID_PTR if the provider cannot decommit)
+
+	@return The number of pages decommitted by this pass
+*/
+POOL_FUNC pool_u pool_multi_reclaim(pool_multi* p, pool_u delay, pool_u keep, pool_err* err)
+{
+	pool_u i;
+	pool_u n = 0;
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(p == NULL, err, POOL_ERR_INVALID_POOL, 0);
+	POOL_SET_ERR_IF(p->provider.decommit == NULL, err, POOL_ERR_INVALID_PTR, 0);
+	for (i = 0; i < p->region_n; i++)
+		n += pool_slab_reclaim(p->regions[i].slab, delay, keep, p->provider.decommit, p->provider.data, NULL);
+	return n;
+}
+
+/**
+	@fn void pool_multi_stat(pool_multi* p, pool_multi_stats* stats, pool_err* err)
+	@brief Stats the multi region pool
+
+	@param[in] p The multi region pool
+	@param[out] stats The statistics
+	@param[out] err The error that happened
+*/
+POOL_FUNC void pool_multi_stat(pool_multi* p, pool_multi_stats* stats, pool_err* err)
+{
+	pool_u i;
+	pool_slab_stats slab;
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(p == NULL, err, POOL_ERR_INVALID_POOL, );
+	POOL_SET_ERR_IF(stats == NULL, err, POOL_ERR_INVALID_PTR, );
+	stats->n_regions = p->region_n;
+	stats->n_regions_empty = 0;
+	stats->size = 0;
+	stats->resident = 0;
+	stats->allocations = 0;
+	stats->maps = p->maps;
+	stats->releases = p->releases;
+	for (i = 0; i < p->region_n; i++)
+	{
+		stats->size += p->regions[i].size;
+		stats->allocations += p->regions[i].allocations;
+		// The header and metadata of a region stay resident
+		pool_slab_stat(p->regions[i].slab, &slab, NULL);
+		stats->resident += p->regions[i].size - (slab.size - slab.resident);
+		if (p->regions[i].allocations == 0)
+			stats->n_regions_empty++;
+	}
+}
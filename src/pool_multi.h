@@ -0,0 +1,197 @@
+/** @file */
+#ifndef POOL_MULTI_H_INCLUDED
+#define POOL_MULTI_H_INCLUDED
+
+#include "pool_slab.h"
+
+/**
+@defgroup MULTI Multi region pool
+A pool of slab regions that gets a new region from a provider when the others are full
+@{
+*/
+
+/** Maximum number of regions of a multi region pool */
+#ifndef POOL_MULTI_REGION_MAX
+#define POOL_MULTI_REGION_MAX 64
+#endif
+
+/** Release delay that never releases the empty regions */
+#define POOL_MULTI_NEVER ((pool_u)-1)
+
+/**
+	@struct _pool_provider
+	@brief Gives and takes back the memory of the regions
+*/
+typedef struct _pool_provider
+{
+	/** Maps size bytes (aligned to the page size), returns NULL on failure */
+	void* (*map)(void* data, pool_size size);
+	/** Unmaps memory given by map */
+	void (*unmap)(void* data, void* mem, pool_size size);
+	/** The data passed to map, unmap and decommit */
+	void* data;
+	/** Gives the physical memory of mapped pages back, they stay mapped (NULL if not supported) */
+	pool_decommit decommit;
+} pool_provider;
+
+/**
+	@struct _pool_multi_region
+	@brief A region of a multi region pool
+*/
+typedef struct _pool_multi_region
+{
+	/** The slab pool, at the start of the region */
+	pool_slab* slab;
+	/** The size of the region */
+	pool_size size;
+	/** The number of live allocations in the region */
+	pool_u allocations;
+	/** The operation at which the region became empty */
+	pool_u empty_since;
+} pool_multi_region;
+
+/**
+	@struct _pool_multi_stats
+	@brief Statistics about a multi region pool
+*/
+typedef struct _pool_multi_stats
+{
+	/** Number of regions */
+	pool_u n_regions;
+	/** Number of empty regions waiting to be released */
+	pool_u n_regions_empty;
+	/** Size of the mapped regions */
+	pool_size size;
+	/** Bytes of the regions that were not decommitted */
+	pool_size resident;
+	/** Number of live allocations */
+	pool_u allocations;
+	/** Number of regions mapped since init */
+	pool_u maps;
+	/** Number of regions released since init */
+	pool_u releases;
+} pool_multi_stats;
+
+/**
+	@struct _pool_multi
+	@brief The multi region pool header
+*/
+typedef struct _pool_multi
+{
+	/** The regions, sorted by address */
+	pool_multi_region regions[POOL_MULTI_REGION_MAX];
+	/** The number of regions */
+	pool_u region_n;
+	/** The region of the last allocation */
+	pool_u hint;
+	/** The size of a new region */
+	pool_size region_size;
+	/** The page size of the regions */
+	pool_size page_size;
+	/** The block size of the regions */
+	pool_size block_size;
+	/** The number of operations an empty region is kept before it is released */
+	pool_u release_delay;
+	/** The number of operations (malloc and free) since init */
+	pool_u ops;
+	/** The operation of the next release check, POOL_MULTI_NEVER if no region is empty */
+	pool_u release_at;
+	/** Gives the memory of the regions */
+	pool_provider provider;
+	/** Number of regions mapped since init */
+	pool_u maps;
+	/** Number of regions released since init */
+	pool_u releases;
+} pool_multi;
+
+/**
+	@fn void pool_multi_init(pool_multi* p, pool_size region_size, pool_size page_size, pool_size block_size, const pool_provider* provider, pool_u release_delay, pool_err* err)
+	@brief Initializes a multi region pool, no region is mapped until the first allocation
+
+	@param[out] p The multi region pool
+	@param[in] region_size The size of a new region (larger allocations get a region of their size)
+	@param[in] page_size The page size of the regions
+	@param[in] block_size The block size of the regions
+	@param[in] provider Gives the memory of the regions
+	@param[in] release_delay The number of operations an empty region is kept (POOL_MULTI_NEVER to keep them)
+	@param[out] err The error that happened
+*/
+POOL_FUNC void pool_multi_init(pool_multi* p, pool_size region_size, pool_size page_size, pool_size block_size, const pool_provider* provider, pool_u release_delay, pool_err* err);
+
+/**
+	@fn void* pool_multi_malloc(pool_multi* p, pool_size size, pool_err* err)
+	@brief Allocates size bytes, maps a new region if the others are full
+
+	@param[inout] p The multi region pool
+	@param[in] size The number of bytes to allocate
+	@param[out] err The error that happened
+
+	@return The allocated buffer
+*/
+POOL_FUNC void* pool_multi_malloc(pool_multi* p, pool_size size, pool_err* err);
+
+/**
+	@fn void pool_multi_free(pool_multi* p, void* ptr, pool_err* err)
+	@brief Frees a buffer in the region that holds it
+
+	@param[inout] p The multi region pool
+	@param[in] ptr The buffer to free
+	@param[out] err The error that happened
+*/
+POOL_FUNC void pool_multi_free(pool_multi* p, void* ptr, pool_err* err);
+
+/**
+	@fn pool_slab* pool_multi_find(pool_multi* p, void* ptr)
+	@brief Finds the region that holds a pointer (binary search on the addresses)
+
+	@param[in] p The multi region pool
+	@param[in] ptr The pointer
+
+	@return The slab pool of the region, NULL if none
+*/
+POOL_FUNC pool_slab* pool_multi_find(pool_multi* p, void* ptr);
+
+/**
+	@fn void pool_multi_release(pool_multi* p, pool_err* err)
+	@brief Releases all the empty regions now
+
+	@param[inout] p The multi region pool
+	@param[out] err The error that happened
+*/
+POOL_FUNC void pool_multi_release(pool_multi* p, pool_err* err);
+
+/**
+	@fn void pool_multi_destroy(pool_multi* p, pool_err* err)
+	@brief Releases all the regions, even if they are not empty
+
+	@param[inout] p The multi region pool
+	@param[out] err The error that happened
+*/
+POOL_FUNC void pool_multi_destroy(pool_multi* p, pool_err* err);
+
+/**
+	@fn pool_u pool_multi_reclaim(pool_multi* p, pool_u delay, pool_u keep, pool_err* err)
+	@brief Gives back the pages of the regions that stayed empty for delay passes with the decommit of the provider
+
+	@param[inout] p The multi region pool
+	@param[in] delay The number of whole passes a page must stay empty (see pool_slab_reclaim)
+	@param[in] keep The number of resident empty pages kept in each region
+	@param[out] err The error that happened (POOL_ERR_INVALID_PTR if the provider cannot decommit)
+
+	@return The number of pages decommitted by this pass
+*/
+POOL_FUNC pool_u pool_multi_reclaim(pool_multi* p, pool_u delay, pool_u keep, pool_err* err);
+
+/**
+	@fn void pool_multi_stat(pool_multi* p, pool_multi_stats* stats, pool_err* err)
+	@brief Stats the multi region pool
+
+	@param[in] p The multi region pool
+	@param[out] stats The statistics
+	@param[out] err The error that happened
+*/
+POOL_FUNC void pool_multi_stat(pool_multi* p, pool_multi_stats* stats, pool_err* err);
+
+/** @} */
+
+#endif
@@ -0,0 +1,284 @@
+#include "pool_os.h"
+
+#include <stdio.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+/** Advice given for decommitted pages (MADV_FREE is cheaper but the pages stay in the RSS until the system needs them) */
+#ifndef POOL_OS_MADVISE
+#define POOL_OS_MADVISE MADV_DONTNEED
+#endif
+#endif
+
+/**
+	@fn void* pool_os_map(void* data, pool_size size)
+	@brief Maps size bytes of zeroed memory from the system (mmap or VirtualAlloc)
+
+	@param[in] data Unused
+	@param[in] size The number of bytes
+
+	@return The memory, NULL on failure
+*/
+POOL_FUNC void* pool_os_map(void* data, pool_size size)
+{
+	void* mem;
+	(void)data;
+#ifdef _WIN32
+	mem = VirtualAlloc(NULL, (SIZE_T)size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+	mem = mmap(NULL, (size_t)size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (mem == MAP_FAILED)
+		mem = NULL;
+#endif
+	return mem;
+}
+
+/**
+	@fn void pool_os_unmap(void* data, void* mem, pool_size size)
+	@brief Gives memory mapped by pool_os_map back to the system
+
+	@param[in] data Unused
+	@param[in] mem The memory
+	@param[in] size The number of bytes
+*/
+POOL_FUNC void pool_os_unmap(void* data, void* mem, pool_size size)
+{
+	(void)data;
+#ifdef _WIN32
+	(void)size;
+	VirtualFree(mem, 0, MEM_RELEASE);
+#else
+	munmap(mem, (size_t)size);
+#endif
+}
+
+/**
+	@fn pool_size pool_os_decommit(void* data, void* mem, pool_size size)
+	@brief Gives the physical memory of mapped pages back to the system (madvise or MEM_RESET), they stay mapped
+
+	Only the whole system pages inside the range are given back.
+
+	@param[in] data Unused
+	@param[in] mem The memory
+	@param[in] size The number of bytes
+
+	@return The system page size, 0 if nothing was given back (the range holds no whole system page or the system refused)
+*/
+POOL_FUNC pool_size pool_os_decommit(void* data, void* mem, pool_size size)
+{
+	pool_u page_size, from, to;
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	page_size = info.dwPageSize;
+#else
+	page_size = (pool_u)sysconf(_SC_PAGESIZE);
+#endif
+	(void)data;
+	// A partial system page may hold used bytes
+	from = POOL_ALIGN_UP((pool_u)mem, page_size);
+	to = ((pool_u)mem + size) & ~(page_size - 1);
+	if (from >= to)
+		return 0;
+#ifdef _WIN32
+	if (VirtualAlloc((void*)from, (SIZE_T)(to - from), MEM_RESET, PAGE_READWRITE) == NULL)
+		return 0;
+#else
+	// MADV_FREE is refused on a shared file mapping
+	if (madvise((void*)from, (size_t)(to - from), POOL_OS_MADVISE) != 0)
+		return 0;
+#endif
+	return page_size;
+}
+
+/**
+	@fn void pool_os_provider(pool_provider* provider)
+	@brief Fills a provider with pool_os_map, pool_os_unmap and pool_os_decommit
+
+	@param[out] provider The provider
+*/
+POOL_FUNC void pool_os_provider(pool_provider* provider)
+{
+	provider->map = pool_os_map;
+	provider->unmap = pool_os_unmap;
+	provider->data = NULL;
+	provider->decommit = pool_os_decommit;
+}
+
+/**
+	@fn static pool_u8 write_file(void* data, const void* buf, pool_size n)
+	@brief Writes bytes of a trace file with stdio
+
+	@param[in] data The FILE
+	@param[in] buf The bytes
+	@param[in] n The number of bytes
+
+	@return 1 if the bytes were written
+*/
+POOL_FUNC static pool_u8 write_file(void* data, const void* buf, pool_size n)
+{
+	return fwrite(buf, 1, (size_t)n, (FILE*)data) == (size_t)n;
+}
+
+/**
+	@fn void pool_os_trace_dump(pool_trace* t, const char* path, pool_err* err)
+	@brief Writes a ring as a trace file on disk
+
+	@param[in] t The ring
+	@param[in] path The path of the file (replaced if it exists)
+	@param[out] err The error that happened (POOL_ERR_IO if the file could not be written)
+*/
+POOL_FUNC void pool_os_trace_dump(pool_trace* t, const char* path, pool_err* err)
+{
+	FILE* f;
+	pool_err err2;
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(path == NULL, err, POOL_ERR_INVALID_PTR, );
+	f = fopen(path, "wb");
+	POOL_SET_ERR_IF(f == NULL, err, POOL_ERR_IO, );
+	pool_trace_dump(t, write_file, f, &err2);
+	if (fclose(f) != 0 && err2 == POOL_ERR_OK)
+		err2 = POOL_ERR_IO;
+	POOL_SET_ERR(err, err2);
+}
+
+/**
+	@fn static void* map_file(const char* path, pool_size* size, pool_u8* created)
+	@brief Maps a whole file shared, creates it with size bytes if it is missing or empty
+
+	@param[in] path The path of the file
+	@param[inout] size The size of a new file, the size of the mapping
+	@param[out] created 1 if the file was created
+
+	@return The memory, NULL on failure
+*/
+POOL_FUNC static void* map_file(const char* path, pool_size* size, pool_u8* created)
+{
+	void* mem;
+#ifdef _WIN32
+	HANDLE file, mapping;
+	LARGE_INTEGER len;
+	file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return NULL;
+	if (!GetFileSizeEx(file, &len))
+	{
+		CloseHandle(file);
+		return NULL;
+	}
+	*created = len.QuadPart == 0;
+	if (!*created)
+		*size = (pool_size)len.QuadPart;
+	// The mapping grows a new file to its size, the view keeps the mapping open
+	mapping = CreateFileMappingA(file, NULL, PAGE_READWRITE, (DWORD)((pool_u64)*size >> 32), (DWORD)*size, NULL);
+	CloseHandle(file);
+	if (mapping == NULL)
+		return NULL;
+	mem = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, (SIZE_T)*size);
+	CloseHandle(mapping);
+#else
+	int fd;
+	struct stat st;
+	fd = open(path, O_RDWR | O_CREAT, 0600);
+	if (fd < 0)
+		return NULL;
+	if (fstat(fd, &st) != 0)
+	{
+		close(fd);
+		return NULL;
+	}
+	*created = st.st_size == 0;
+	if (!*created)
+		*size = (pool_size)st.st_size;
+	else if (ftruncate(fd, (off_t)*size) != 0)
+	{
+		close(fd);
+		return NULL;
+	}
+	// The mapping keeps the file open
+	mem = mmap(NULL, (size_t)*size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (mem == MAP_FAILED)
+		mem = NULL;
+#endif
+	return mem;
+}
+
+/**
+	@fn static pool_u8 unmap_file(void* mem, pool_size size)
+	@brief Writes a mapping of map_file to its file and unmaps it
+
+	@param[in] mem The memory
+	@param[in] size The size of the mapping
+
+	@return 1 if the memory was written
+*/
+POOL_FUNC static pool_u8 unmap_file(void* mem, pool_size size)
+{
+	pool_u8 ok;
+#ifdef _WIN32
+	(void)size;
+	ok = FlushViewOfFile(mem, 0) != 0;
+	UnmapViewOfFile(mem);
+#else
+	ok = msync(mem, (size_t)size, MS_SYNC) == 0;
+	munmap(mem, (size_t)size);
+#endif
+	return ok;
+}
+
+/**
+	@fn pool_slab* pool_os_slab_open(const char* path, pool_size size, pool_size page_size, pool_size block_size, pool_err* err)
+	@brief Maps a file shared and takes back the slab pool it holds, or creates the file and a pool in it
+
+	The allocations and the data written in the buffers are kept in the file, pool_slab_root finds the data again.
+	An existing file is mapped at its own size and its pool keeps its geometry.
+
+	@param[in] path The path of the file
+	@param[in] size The size of a new file
+	@param[in] page_size The page size of a new pool
+	@param[in] block_size The block size of a new pool
+	@param[out] err The error that happened (POOL_ERR_IO if the file could not be mapped, POOL_ERR_INVALID_POOL if it does not hold a valid pool)
+
+	@return The slab pool, NULL on failure
+*/
+POOL_FUNC pool_slab* pool_os_slab_open(const char* path, pool_size size, pool_size page_size, pool_size block_size, pool_err* err)
+{
+	void* mem;
+	pool_u8 created;
+	pool_slab* p;
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(path == NULL, err, POOL_ERR_INVALID_PTR, NULL);
+	mem = map_file(path, &size, &created);
+	POOL_SET_ERR_IF(mem == NULL, err, POOL_ERR_IO, NULL);
+	if (created)
+		p = pool_slab_create(mem, size, page_size, block_size, err);
+	else
+		p = pool_slab_attach(mem, size, err);
+	if (p == NULL)
+		unmap_file(mem, size);
+	return p;
+}
+
+/**
+	@fn void pool_os_slab_close(pool_slab* p, pool_err* err)
+	@brief Detaches a pool opened by pool_os_slab_open, writes it to its file and unmaps it
+
+	@param[in] p The slab pool
+	@param[out] err The error that happened (POOL_ERR_IO if the file could not be written)
+*/
+POOL_FUNC void pool_os_slab_close(pool_slab* p, pool_err* err)
+{
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(p == NULL || p->magic != POOL_SLAB_MAGIC, err, POOL_ERR_INVALID_POOL, );
+	pool_slab_detach(p, NULL);
+	POOL_SET_ERR_IF(!unmap_file(p, p->region_size), err, POOL_ERR_IO, );
+}
@@ -0,0 +1,94 @@
+/** @file */
+#ifndef POOL_OS_H_INCLUDED
+#define POOL_OS_H_INCLUDED
+
+#include "pool_multi.h"
+
+/**
+@defgroup OS Operating system memory
+Kept out of libmm (in libmmos) so the pools themselves have no dependency
+@{
+*/
+
+/**
+	@fn void* pool_os_map(void* data, pool_size size)
+	@brief Maps size bytes of zeroed memory from the system (mmap or VirtualAlloc)
+
+	@param[in] data Unused
+	@param[in] size The number of bytes
+
+	@return The memory, NULL on failure
+*/
+POOL_FUNC void* pool_os_map(void* data, pool_size size);
+
+/**
+	@fn void pool_os_unmap(void* data, void* mem, pool_size size)
+	@brief Gives memory mapped by pool_os_map back to the system
+
+	@param[in] data Unused
+	@param[in] mem The memory
+	@param[in] size The number of bytes
+*/
+POOL_FUNC void pool_os_unmap(void* data, void* mem, pool_size size);
+
+/**
+	@fn pool_size pool_os_decommit(void* data, void* mem, pool_size size)
+	@brief Gives the physical memory of mapped pages back to the system (madvise or MEM_RESET), they stay mapped
+
+	Only the whole system pages inside the range are given back.
+
+	@param[in] data Unused
+	@param[in] mem The memory
+	@param[in] size The number of bytes
+
+	@return The system page size, 0 if nothing was given back (the range holds no whole system page or the system refused)
+*/
+POOL_FUNC pool_size pool_os_decommit(void* data, void* mem, pool_size size);
+
+/**
+	@fn void pool_os_provider(pool_provider* provider)
+	@brief Fills a provider with pool_os_map, pool_os_unmap and pool_os_decommit
+
+	@param[out] provider The provider
+*/
+POOL_FUNC void pool_os_provider(pool_provider* provider);
+
+/**
+	@fn void pool_os_trace_dump(pool_trace* t, const char* path, pool_err* err)
+	@brief Writes a ring as a trace file on disk
+
+	@param[in] t The ring
+	@param[in] path The path of the file (replaced if it exists)
+	@param[out] err The error that happened (POOL_ERR_IO if the file could not be written)
+*/
+POOL_FUNC void pool_os_trace_dump(pool_trace* t, const char* path, pool_err* err);
+
+/**
+	@fn pool_slab* pool_os_slab_open(const char* path, pool_size size, pool_size page_size, pool_size block_size, pool_err* err)
+	@brief Maps a file shared and takes back the slab pool it holds, or creates the file and a pool in it
+
+	The allocations and the data written in the buffers are kept in the file, pool_slab_root finds the data again.
+	An existing file is mapped at its own size and its pool keeps its geometry.
+
+	@param[in] path The path of the file
+	@param[in] size The size of a new file
+	@param[in] page_size The page size of a new pool
+	@param[in] block_size The block size of a new pool
+	@param[out] err The error that happened (POOL_ERR_IO if the file could not be mapped, POOL_ERR_INVALID_POOL if it does not hold a valid pool)
+
+	@return The slab pool, NULL on failure
+*/
+POOL_FUNC pool_slab* pool_os_slab_open(const char* path, pool_size size, pool_size page_size, pool_size block_size, pool_err* err);
+
+/**
+	@fn void pool_os_slab_close(pool_slab* p, pool_err* err)
+	@brief Detaches a pool opened by pool_os_slab_open, writes it to its file and unmaps it
+
+	@param[in] p The slab pool
+	@param[out] err The error that happened (POOL_ERR_IO if the file could not be written)
+*/
+POOL_FUNC void pool_os_slab_close(pool_slab* p, pool_err* err);
+
+/** @} */
+
+#endif
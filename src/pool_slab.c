@@ -1,253 +1,1783 @@
 #include "pool_slab.h"
 
+/** Shift of the 2 bits of a page in its byte of the slab array */
+#define SLAB_SHIFT(at) (6 - 2 * ((at) % 4))
+
 /**
 	@fn static pool_slab_page_type get_2_bits(char* buf, pool_u at)
 	@brief Gets the type at the index
 
-	@param buf The slab array
-	@param at The index
+	@param buf The slab array
+	@param at The index
+
+	@return The type of page
+*/
+POOL_FUNC static pool_slab_page_type get_2_bits(pool_u8* buf, pool_u at)
+{
+	return (pool_slab_page_type)((POOL_ATOMIC_LOAD(buf + at / 4) >> SLAB_SHIFT(at)) & 3);
+}
+
+/**
+	@fn static void set_2_bits(char* buf, pool_u at, pool_slab_page_type type)
+	@brief Sets the type at the index
+
+	@param buf the slab array
+	@param at The index
+	@param type The type to set
+*/
+POOL_FUNC static void set_2_bits(pool_u8* buf, pool_u at, pool_slab_page_type type)
+{
+	pool_u8 old_val, new_val;
+	do
+	{
+		old_val = POOL_ATOMIC_LOAD(buf + at / 4);
+		new_val = (pool_u8)((old_val & ~(3 << SLAB_SHIFT(at))) | (type << SLAB_SHIFT(at)));
+	} while (!POOL_ATOMIC_CAS(buf + at / 4, old_val, new_val));
+}
+
+/**
+	@fn static void order_unlink(pool_slab* p, pool_u page)
+	@brief Removes a page from its order list
+
+	@param[inout] p The slab struct
+	@param[in] page The page
+*/
+POOL_FUNC static void order_unlink(pool_slab* p, pool_u page)
+{
+	pool_u8 order = p->order[page];
+	pool_u next = p->order_next[page];
+	pool_u prev = p->order_prev[page];
+	if (order == POOL_BUDDY_ORDER_NONE)
+		return;
+	if (prev == p->page_n)
+		p->order_head[order] = next;
+	else
+		p->order_next[prev] = next;
+	if (next != p->page_n)
+		p->order_prev[next] = prev;
+	if (p->order_head[order] == p->page_n)
+		p->order_mask &= ~((pool_u)1 << order);
+	p->order_count[order]--;
+	p->order[page] = POOL_BUDDY_ORDER_NONE;
+}
+
+/**
+	@fn static void order_link(pool_slab* p, pool_u page, pool_u8 order)
+	@brief Moves a page at the head of an order list
+
+	@param[inout] p The slab struct
+	@param[in] page The page
+	@param[in] order The order of the largest free block of the page (POOL_BUDDY_ORDER_NONE for no list)
+*/
+POOL_FUNC static void order_link(pool_slab* p, pool_u page, pool_u8 order)
+{
+	if (p->order[page] == order)
+		return;
+	order_unlink(p, page);
+	if (order == POOL_BUDDY_ORDER_NONE)
+		return;
+	p->order[page] = order;
+	p->order_prev[page] = p->page_n;
+	p->order_next[page] = p->order_head[order];
+	if (p->order_head[order] != p->page_n)
+		p->order_prev[p->order_head[order]] = page;
+	p->order_head[order] = page;
+	p->order_mask |= (pool_u)1 << order;
+	p->order_count[order]++;
+}
+
+/**
+	@fn static pool_u find_order_page(pool_slab* p, pool_u8 order)
+	@brief Finds the page with the smallest free block that can hold a block of the order
+
+	@param[in] p The slab struct
+	@param[in] order The order of the block
+
+	@return The page, p->page_n if none
+*/
+POOL_FUNC static pool_u find_order_page(pool_slab* p, pool_u8 order)
+{
+	pool_u mask = p->order_mask & ~(((pool_u)1 << order) - 1);
+	if (mask == 0)
+		return p->page_n;
+	return p->order_head[POOL_CTZ(mask)];
+}
+
+/**
+	@fn static void run_unlink(pool_slab* p, pool_u page)
+	@brief Removes a free run from its run list
+
+	@param[inout] p The slab struct
+	@param[in] page The first page of the run
+*/
+POOL_FUNC static void run_unlink(pool_slab* p, pool_u page)
+{
+	pool_u8 order = p->run_order[page];
+	pool_u next = p->order_next[page];
+	pool_u prev = p->order_prev[page];
+	if (prev == p->page_n)
+		p->run_head[order] = next;
+	else
+		p->order_next[prev] = next;
+	if (next != p->page_n)
+		p->order_prev[next] = prev;
+	if (p->run_head[order] == p->page_n)
+		p->run_mask &= ~((pool_u)1 << order);
+	p->run_count[order]--;
+	p->run_order[page] = POOL_BUDDY_ORDER_NONE;
+}
+
+/**
+	@fn static void run_link(pool_slab* p, pool_u page, pool_u8 order)
+	@brief Adds a free run at the head of its run list
+
+	@param[inout] p The slab struct
+	@param[in] page The first page of the run
+	@param[in] order The order of the run
+*/
+POOL_FUNC static void run_link(pool_slab* p, pool_u page, pool_u8 order)
+{
+	p->run_order[page] = order;
+	p->order_prev[page] = p->page_n;
+	p->order_next[page] = p->run_head[order];
+	if (p->run_head[order] != p->page_n)
+		p->order_prev[p->run_head[order]] = page;
+	p->run_head[order] = page;
+	p->run_mask |= (pool_u)1 << order;
+	p->run_count[order]++;
+}
+
+/**
+	@fn static pool_u8 run_fit(pool_u page, pool_u n)
+	@brief Gets the order of the largest aligned run starting at a page that fits in n pages
+
+	@param[in] page The first page
+	@param[in] n The number of pages (not 0)
+
+	@return The order of the run
+*/
+POOL_FUNC static pool_u8 run_fit(pool_u page, pool_u n)
+{
+	pool_u order = pool_log2(n);
+	if (page != 0 && POOL_CTZ(page) < order)
+		order = POOL_CTZ(page);
+	return (pool_u8)order;
+}
+
+/**
+	@fn static void runs_add(pool_slab* p, pool_u page, pool_u n)
+	@brief Adds n empty pages that were split from a free run, the pieces cannot be merged
+
+	@param[inout] p The slab struct
+	@param[in] page The first page
+	@param[in] n The number of pages
+*/
+POOL_FUNC static void runs_add(pool_slab* p, pool_u page, pool_u n)
+{
+	pool_u8 order;
+	while (n != 0)
+	{
+		order = run_fit(page, n);
+		run_link(p, page, order);
+		page += (pool_u)1 << order;
+		n -= (pool_u)1 << order;
+	}
+}
+
+/**
+	@fn static void runs_free(pool_slab* p, pool_u page, pool_u n)
+	@brief Adds n pages that became empty, each run is merged with its buddy run while it is free
+
+	@param[inout] p The slab struct
+	@param[in] page The first page
+	@param[in] n The number of pages
+*/
+POOL_FUNC static void runs_free(pool_slab* p, pool_u page, pool_u n)
+{
+	pool_u8 order;
+	pool_u run, buddy, i;
+	for (i = page; i < page + n; i++)
+		p->empty_since[i] = p->epoch;
+	while (n != 0)
+	{
+		order = run_fit(page, n);
+		page += (pool_u)1 << order;
+		n -= (pool_u)1 << order;
+		run = page - ((pool_u)1 << order);
+		for (; (pool_u)order + 1 < POOL_SLAB_RUN_ORDER_MAX; order++)
+		{
+			buddy = run ^ ((pool_u)1 << order);
+			if (buddy >= p->page_n || p->run_order[buddy] != order)
+				break;
+			run_unlink(p, buddy);
+			run &= buddy;
+		}
+		run_link(p, run, order);
+	}
+}
+
+/**
+	@fn static void runs_remove(pool_slab* p, pool_u page, pool_u n)
+	@brief Removes n empty pages from the free runs, the rest of the runs they were in are given back
+
+	@param[inout] p The slab struct
+	@param[in] page The first page
+	@param[in] n The number of pages
+*/
+POOL_FUNC static void runs_remove(pool_slab* p, pool_u page, pool_u n)
+{
+	pool_u i = page;
+	pool_u run, end;
+	pool_u8 order;
+	while (i < page + n)
+	{
+		// The run holding i starts at i rounded down to its size
+		for (order = 0; p->run_order[i & ~(((pool_u)1 << order) - 1)] != order; order++);
+		run = i & ~(((pool_u)1 << order) - 1);
+		end = run + ((pool_u)1 << order);
+		run_unlink(p, run);
+		runs_add(p, run, i - run);
+		if (end > page + n)
+			runs_add(p, page + n, end - page - n);
+		i = end;
+	}
+}
+
+/**
+	@fn static pool_u find_free_run(pool_slab* p, pool_u n)
+	@brief Finds the smallest free run that can hold n pages
+
+	@param[in] p The slab struct
+	@param[in] n The number of pages
+
+	@return The first page of the run, p->page_n if none (or n is 0)
+*/
+POOL_FUNC static pool_u find_free_run(pool_slab* p, pool_u n)
+{
+	pool_u order, mask;
+	if (n == 0 || n > p->page_n)
+		return p->page_n;
+	order = n == 1 ? 0 : pool_log2(n - 1) + 1;
+	mask = p->run_mask & ~(((pool_u)1 << order) - 1);
+	if (mask == 0)
+		return p->page_n;
+	return p->run_head[POOL_CTZ(mask)];
+}
+
+/**
+	@fn static void recommit(pool_slab* p, pool_u page, pool_u n)
+	@brief Forgets that n empty pages were decommitted before they are used, the index lock must be held
+
+	The system gives the pages back on first touch, only the bits and the counter are updated.
+
+	@param[inout] p The slab struct
+	@param[in] page The first page
+	@param[in] n The number of pages
+*/
+POOL_FUNC static void recommit(pool_slab* p, pool_u page, pool_u n)
+{
+	pool_u i;
+	if (p->decommitted_n == 0)
+		return;
+	for (i = pool_bitmap_next_set(p->decommitted, page + n, page); i < page + n; i = pool_bitmap_next_set(p->decommitted, page + n, i + 1))
+		p->decommitted_n--;
+	pool_bitmap_clear_range(p->decommitted, page, n);
+}
+
+/**
+	@fn static pool_u take_empty_page(pool_slab* p)
+	@brief Takes the first page of the smallest free run for a buddy allocation, the index lock must be held
+
+	The page stays EMPTY but is not in the free runs, so only the caller can use it.
+
+	@param[inout] p The slab struct
+
+	@return The page, p->page_n if no page is empty
+*/
+POOL_FUNC static pool_u take_empty_page(pool_slab* p)
+{
+	pool_u page = find_free_run(p, 1);
+	if (page == p->page_n)
+		return page;
+	runs_remove(p, page, 1);
+	pool_bitmap_clear_range(p->empty, page, 1);
+	recommit(p, page, 1);
+	return page;
+}
+
+/**
+	@fn static void claim_run(pool_slab* p, pool_u page, pool_u n)
+	@brief Makes n empty pages RAW, the index lock must be held
+
+	@param[inout] p The slab struct
+	@param[in] page The first page
+	@param[in] n The number of pages
+*/
+POOL_FUNC static void claim_run(pool_slab* p, pool_u page, pool_u n)
+{
+	pool_u i;
+	runs_remove(p, page, n);
+	pool_bitmap_clear_range(p->empty, page, n);
+	recommit(p, page, n);
+	for (i = page; i < page + n; i++)
+		set_2_bits(p->slabs, i, RAW);
+	p->page_count[EMPTY] -= n;
+	p->page_count[RAW] += n;
+	p->used += n << p->page_shift;
+}
+
+/**
+	@fn static void release_run(pool_slab* p, pool_u page, pool_u n)
+	@brief Makes n RAW pages empty, the index lock must be held
+
+	@param[inout] p The slab struct
+	@param[in] page The first page
+	@param[in] n The number of pages
+*/
+POOL_FUNC static void release_run(pool_slab* p, pool_u page, pool_u n)
+{
+	pool_u i;
+	for (i = page; i < page + n; i++)
+		set_2_bits(p->slabs, i, EMPTY);
+	pool_bitmap_set_range(p->empty, page, n);
+	runs_free(p, page, n);
+	p->page_count[RAW] -= n;
+	p->page_count[EMPTY] += n;
+	p->used -= n << p->page_shift;
+}
+
+/**
+	@fn static pool_u find_aligned_run(pool_slab* p, pool_u n, pool_u first, pool_u step)
+	@brief Finds n empty pages starting on one of the pages first + k * step
+
+	@param[in] p The slab struct
+	@param[in] n The number of pages
+	@param[in] first The first aligned page
+	@param[in] step The number of pages between two aligned pages
+
+	@return The first page of the run, p->page_n if none
+*/
+POOL_FUNC static pool_u find_aligned_run(pool_slab* p, pool_u n, pool_u first, pool_u step)
+{
+	pool_u page = first;
+	pool_u end;
+	while (page < p->page_n && n <= p->page_n - page)
+	{
+		end = pool_bitmap_next_clear(p->empty, p->page_n, page);
+		if (end - page >= n)
+			return page;
+		page += POOL_ALIGN_UP(end + 1 - page, step);
+	}
+	return p->page_n;
+}
+
+/**
+	@fn static pool_u page_of(pool_slab* p, void* ptr)
+	@brief Gets the page of a pointer
+
+	@param[in] p The slab struct
+	@param[in] ptr The pointer
+
+	@return The page, p->page_n if the pointer is not in the pool
+*/
+POOL_FUNC static pool_u page_of(pool_slab* p, void* ptr)
+{
+	if (ptr < p->mem || (char*)ptr >= (char*)p->mem + (p->page_n << p->page_shift))
+		return p->page_n;
+	return ((pool_u)ptr - (pool_u)p->mem) >> p->page_shift;
+}
+
+#ifdef POOL_TRACE
+/** Reads the clock at the start of a traced operation */
+#define TRACE_START() pool_u64 trace_start = POOL_TRACE_CLOCK()
+/** Records a traced operation */
+#define TRACE(p, kind, size, ptr, retries, err) trace(p, kind, trace_start, size, ptr, retries, err)
+
+/**
+	@fn static void trace(pool_slab* p, pool_trace_kind kind, pool_u64 start, pool_size size, void* ptr, pool_u8 retries, pool_err err)
+	@brief Records an operation in the ring of the calling thread
+
+	@param[in] p The slab struct
+	@param[in] kind The operation
+	@param[in] start The clock at the start of the operation
+	@param[in] size The requested or freed size
+	@param[in] ptr The returned or freed buffer
+	@param[in] retries The number of pages that changed before they were locked
+	@param[in] err The error of the operation
+*/
+POOL_FUNC static void trace(pool_slab* p, pool_trace_kind kind, pool_u64 start, pool_size size, void* ptr, pool_u8 retries, pool_err err)
+{
+	pool_u64 end = POOL_TRACE_CLOCK();
+	pool_trace_event* e;
+	// free(NULL) does nothing
+	if (ptr == NULL && kind == POOL_TRACE_FREE && err == POOL_ERR_OK)
+		return;
+	e = pool_trace_next();
+	if (e == NULL)
+		return;
+	e->time = start;
+	e->ptr = (pool_u64)(pool_u)ptr;
+	e->size = size;
+	e->cycles = (pool_u32)(end - start);
+	e->page = p != NULL ? (pool_u32)page_of(p, ptr) : 0;
+	e->kind = (pool_u8)kind;
+	e->order = p != NULL && size != 0 && size <= p->page_size ? pool_buddy_order(p->buddies, size) : POOL_BUDDY_ORDER_NONE;
+	e->err = err;
+	e->retries = retries;
+}
+
+/** Records the buffers of a batch */
+#define TRACE_BATCH(p, kind, size, ptrs, n, err) trace_batch(p, kind, trace_start, size, ptrs, n, err)
+
+/**
+	@fn static void trace_batch(pool_slab* p, pool_trace_kind kind, pool_u64 start, pool_size size, void** ptrs, pool_u n, pool_err err)
+	@brief Records an operation for each buffer of a batch
+
+	@param[in] p The slab struct
+	@param[in] kind The operation
+	@param[in] start The clock at the start of the batch
+	@param[in] size The requested or freed size of a buffer
+	@param[in] ptrs The buffers
+	@param[in] n The number of buffers
+	@param[in] err The error of the operations
+*/
+POOL_FUNC static void trace_batch(pool_slab* p, pool_trace_kind kind, pool_u64 start, pool_size size, void** ptrs, pool_u n, pool_err err)
+{
+	pool_u i;
+	for (i = 0; i < n; i++)
+		trace(p, kind, start, size, ptrs[i], 0, err);
+}
+#else
+/** Reads the clock at the start of a traced operation (nothing to do) */
+#define TRACE_START()
+/** Records a traced operation (nothing to do, the size may only be computed for the trace) */
+#define TRACE(p, kind, size, ptr, retries, err) (void)(size)
+/** Records the buffers of a batch (nothing to do) */
+#define TRACE_BATCH(p, kind, size, ptrs, n, err)
+#endif
+
+/**
+	@fn static pool_u8* set_layout(pool_slab* p, void* mem, void* meta, pool_size tree_size)
+	@brief Sets the pointers to the memory and to the metadata arrays from the number of pages
+
+	@param[inout] p The slab struct
+	@param[in] mem The memory base
+	@param[in] meta The metadata storage
+	@param[in] tree_size The size of the metadata of a buddy
+
+	@return The buddy trees
+*/
+POOL_FUNC static pool_u8* set_layout(pool_slab* p, void* mem, void* meta, pool_size tree_size)
+{
+	pool_u8* trees;
+	// Pointer sized arrays first
+	p->mem = mem;
+	p->buddies = (pool_buddy*)meta;
+	p->order_next = (pool_u*)(p->buddies + p->page_n);
+	p->order_prev = p->order_next + p->page_n;
+	p->raw_n = p->order_prev + p->page_n;
+	p->empty_since = p->raw_n + p->page_n;
+	p->empty = p->empty_since + p->page_n;
+	p->decommitted = p->empty + POOL_BITMAP_SIZE(p->page_n);
+	trees = (pool_u8*)(p->decommitted + POOL_BITMAP_SIZE(p->page_n));
+	p->order = trees + p->page_n*tree_size;
+	p->run_order = p->order + p->page_n;
+	p->slabs = p->run_order + p->page_n;
+	return trees;
+}
+
+/**
+	@fn void pool_slab_init(pool_slab* p, void* mem, pool_size size, pool_size page_size, pool_size block_size, void* meta, pool_err* err)
+	@brief Initializes the slab pool
+
+	page_size and block_size must be powers of 2, size is rounded down to a multiple of page_size.
+
+	@param[inout] p The slab struct
+	@param[in] mem The memory base
+	@param[in] size The size of the memory
+	@param[in] page_size The size of a page
+	@param[in] block_size The size of a block in a page
+	@param[in] meta The metadata storage (POOL_SLAB_META_SIZE(size, page_size, block_size) bytes, pointer aligned)
+	@param[out] err The error that happened
+*/
+POOL_FUNC void pool_slab_init(pool_slab* p, void* mem, pool_size size, pool_size page_size, pool_size block_size, void* meta, pool_err* err)
+{
+	pool_u i;
+	pool_u8* trees;
+	pool_size tree_size;
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(p == NULL, err, POOL_ERR_INVALID_POOL, );
+	POOL_SET_ERR_IF(mem == NULL || meta == NULL, err, POOL_ERR_INVALID_PTR, );
+	POOL_SET_ERR_IF(!POOL_IS_POW2(page_size) || !POOL_IS_POW2(block_size) || block_size > page_size || size < page_size, err, POOL_ERR_INVALID_SIZE, );
+	p->magic = 0;
+	p->layout = POOL_SLAB_LAYOUT;
+	p->page_n = size / page_size;
+	p->page_size = page_size;
+	p->page_shift = (pool_u8)pool_log2(page_size);
+	p->block_shift = (pool_u8)pool_log2(block_size);
+	p->attached = 0;
+	p->region_size = 0;
+	p->root = POOL_SLAB_NO_ROOT;
+	p->page_count[EMPTY] = p->page_n;
+	p->page_count[PARTIAL] = 0;
+	p->page_count[FULL] = 0;
+	p->page_count[RAW] = 0;
+	p->used = 0;
+
+	tree_size = POOL_BUDDY_META_SIZE(page_size, block_size);
+	trees = set_layout(p, mem, meta, tree_size);
+
+	for (i = 0; i < POOL_CEIL_DIV(p->page_n, 4); i++)
+		p->slabs[i] = 0x00;
+	for (i = 0; i < POOL_BITMAP_SIZE(p->page_n); i++)
+	{
+		p->empty[i] = 0;
+		p->decommitted[i] = 0;
+	}
+	p->decommitted_n = 0;
+	p->epoch = 0;
+	for (i = 0; i < p->page_n; i++)
+	{
+		p->raw_n[i] = 0;
+		p->run_order[i] = POOL_BUDDY_ORDER_NONE;
+		p->empty_since[i] = p->epoch;
+	}
+	pool_bitmap_set_range(p->empty, 0, p->page_n);
+#ifdef POOL_CONCURRENT
+	p->lock = 0;
+#endif
+	p->order_mask = 0;
+	for (i = 0; i < POOL_BUDDY_ORDER_MAX; i++)
+	{
+		p->order_head[i] = p->page_n;
+		p->order_count[i] = 0;
+	}
+	p->run_mask = 0;
+	for (i = 0; i < POOL_SLAB_RUN_ORDER_MAX; i++)
+	{
+		p->run_head[i] = p->page_n;
+		p->run_count[i] = 0;
+	}
+	for (i = 0; i < p->page_n; i++)
+	{
+		pool_buddy_init(p->buddies + i, (char*)mem + (i << p->page_shift), page_size, block_size, trees + i*tree_size, err);
+		POOL_SET_ERR_IF(err ? *err : 0, err, *err, );
+		p->order[i] = POOL_BUDDY_ORDER_NONE;
+	}
+	runs_add(p, 0, p->page_n);
+}
+
+/**
+	@fn pool_slab* pool_slab_create(void* mem, pool_size size, pool_size page_size, pool_size block_size, pool_err* err)
+	@brief Creates a slab pool with its header and metadata at the start of the memory
+
+	The pages start at the first multiple of page_size (from mem) after the metadata.
+
+	@param[in] mem The memory base (pointer aligned)
+	@param[in] size The size of the memory
+	@param[in] page_size The size of a page
+	@param[in] block_size The size of a block in a page
+	@param[out] err The error that happened
+
+	@return The slab pool, NULL if mem is too small
+*/
+POOL_FUNC pool_slab* pool_slab_create(void* mem, pool_size size, pool_size page_size, pool_size block_size, pool_err* err)
+{
+	pool_u page_n;
+	pool_err err2;
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(mem == NULL || (pool_u)mem % sizeof(void*) != 0, err, POOL_ERR_INVALID_PTR, NULL);
+	POOL_SET_ERR_IF(!POOL_IS_POW2(page_size) || !POOL_IS_POW2(block_size) || block_size > page_size, err, POOL_ERR_INVALID_SIZE, NULL);
+
+	// Every page costs its size and its metadata, the header can waste up to a page
+	page_n = size / (page_size + POOL_SLAB_META_SIZE_N(1, page_size, block_size));
+	while (POOL_SLAB_CREATE_SIZE(page_n + 1, page_size, block_size) <= size)
+		page_n++;
+	while (page_n > 0 && POOL_SLAB_CREATE_SIZE(page_n, page_size, block_size) > size)
+		page_n--;
+	POOL_SET_ERR_IF(page_n == 0, err, POOL_ERR_OUT_OF_MEM, NULL);
+
+	pool_slab_init((pool_slab*)mem, (char*)mem + POOL_SLAB_CREATE_SIZE(page_n, page_size, block_size) - page_n*page_size, page_n*page_size, page_size, block_size, (pool_slab*)mem + 1, &err2);
+	POOL_SET_ERR_IF(err2 != POOL_ERR_OK, err, err2, NULL);
+	((pool_slab*)mem)->magic = POOL_SLAB_MAGIC;
+	((pool_slab*)mem)->region_size = size;
+	((pool_slab*)mem)->attached = 1;
+	return (pool_slab*)mem;
+}
+
+/**
+	@fn pool_slab* pool_slab_attach(void* mem, pool_size size, pool_err* err)
+	@brief Takes back a pool made by pool_slab_create, the memory may be mapped at another address
+
+	Checks the header (magic, build layout, size, geometry, counters) and sets the pointers from the geometry,
+	the pages are not visited. A pool that was not detached (its process stopped while using it) gets its locks
+	released and is checked with pool_slab_verify.
+
+	@param[in] mem The memory base, the same bytes as the one given to pool_slab_create
+	@param[in] size The size of the memory, the size given to pool_slab_create
+	@param[out] err The error that happened (POOL_ERR_INVALID_POOL if the memory does not hold a valid pool)
+
+	@return The slab pool, NULL on failure
+*/
+POOL_FUNC pool_slab* pool_slab_attach(void* mem, pool_size size, pool_err* err)
+{
+	pool_slab* p = (pool_slab*)mem;
+	pool_size page_size, block_size;
+	pool_u i;
+	pool_err err2;
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(mem == NULL || (pool_u)mem % sizeof(void*) != 0, err, POOL_ERR_INVALID_PTR, NULL);
+	POOL_SET_ERR_IF(size < sizeof(pool_slab), err, POOL_ERR_INVALID_POOL, NULL);
+	POOL_SET_ERR_IF(p->magic != POOL_SLAB_MAGIC || p->layout != POOL_SLAB_LAYOUT || p->region_size != size, err, POOL_ERR_INVALID_POOL, NULL);
+
+	// The geometry must be the one pool_slab_create computes for this size
+	POOL_SET_ERR_IF(p->page_shift >= sizeof(pool_size) * 8 || p->block_shift > p->page_shift, err, POOL_ERR_INVALID_POOL, NULL);
+	page_size = (pool_size)1 << p->page_shift;
+	block_size = (pool_size)1 << p->block_shift;
+	POOL_SET_ERR_IF(p->page_size != page_size || p->page_n == 0 || p->page_n > size / page_size, err, POOL_ERR_INVALID_POOL, NULL);
+	POOL_SET_ERR_IF(POOL_SLAB_CREATE_SIZE(p->page_n, page_size, block_size) > size, err, POOL_ERR_INVALID_POOL, NULL);
+	POOL_SET_ERR_IF(p->page_count[EMPTY] + p->page_count[PARTIAL] + p->page_count[FULL] + p->page_count[RAW] != p->page_n, err, POOL_ERR_INVALID_POOL, NULL);
+	POOL_SET_ERR_IF(p->used > p->page_n << p->page_shift, err, POOL_ERR_INVALID_POOL, NULL);
+	POOL_SET_ERR_IF(p->root != POOL_SLAB_NO_ROOT && p->root >= p->page_n << p->page_shift, err, POOL_ERR_INVALID_POOL, NULL);
+
+	set_layout(p, (char*)mem + POOL_SLAB_CREATE_SIZE(p->page_n, page_size, block_size) - p->page_n*page_size, p + 1, POOL_BUDDY_META_SIZE(page_size, block_size));
+	POOL_SET_ERR_IF(p->buddies[0].mem_offset != (pool_u)p->mem - (pool_u)p->buddies, err, POOL_ERR_INVALID_POOL, NULL);
+	POOL_SET_ERR_IF(p->buddies[0].depth != p->page_shift - p->block_shift, err, POOL_ERR_INVALID_POOL, NULL);
+
+	if (p->attached)
+	{
+		// Not detached, the locks of the stopped process are released and every page is checked
+#ifdef POOL_CONCURRENT
+		p->lock = 0;
+		for (i = 0; i < p->page_n; i++)
+			p->buddies[i].lock = 0;
+#else
+		(void)i;
+#endif
+		pool_slab_verify(p, &err2);
+		POOL_SET_ERR_IF(err2 != POOL_ERR_OK, err, err2, NULL);
+	}
+	p->attached = 1;
+	return p;
+}
+
+/**
+	@fn void pool_slab_detach(pool_slab* p, pool_err* err)
+	@brief Marks a pool made by pool_slab_create as closed, pool_slab_attach will not check its pages
+
+	No thread may use the pool after.
+
+	@param[inout] p The slab struct
+	@param[out] err The error that happened
+*/
+POOL_FUNC void pool_slab_detach(pool_slab* p, pool_err* err)
+{
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(p == NULL, err, POOL_ERR_INVALID_POOL, );
+	p->attached = 0;
+}
+
+/**
+	@fn void pool_slab_set_root(pool_slab* p, void* ptr, pool_err* err)
+	@brief Records a buffer to find the data of the pool after pool_slab_attach
+
+	@param[inout] p The slab struct
+	@param[in] ptr The buffer (NULL for none)
+	@param[out] err The error that happened
+*/
+POOL_FUNC void pool_slab_set_root(pool_slab* p, void* ptr, pool_err* err)
+{
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(p == NULL, err, POOL_ERR_INVALID_POOL, );
+	if (ptr == NULL)
+	{
+		p->root = POOL_SLAB_NO_ROOT;
+		return;
+	}
+	POOL_SET_ERR_IF((char*)ptr < (char*)p->mem || (char*)ptr >= (char*)p->mem + (p->page_n << p->page_shift), err, POOL_ERR_INVALID_PTR, );
+	p->root = POOL_SLAB_OFFSET(p, ptr);
+}
+
+/**
+	@fn void* pool_slab_root(pool_slab* p, pool_err* err)
+	@brief Gets the buffer recorded by pool_slab_set_root, at the current address of the pool
+
+	@param[in] p The slab struct
+	@param[out] err The error that happened
+
+	@return The buffer, NULL if none
+*/
+POOL_FUNC void* pool_slab_root(pool_slab* p, pool_err* err)
+{
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(p == NULL, err, POOL_ERR_INVALID_POOL, NULL);
+	if (p->root == POOL_SLAB_NO_ROOT)
+		return NULL;
+	return POOL_SLAB_PTR(p, p->root);
+}
+
+/**
+	@fn void pool_slab_static_init(pool_slab_static* p, void* mem, pool_err* err)
+	@brief Initializes a slab pool with the default geometry
+
+	@param[inout] p The slab struct
+	@param[in] mem The memory base (POOL_SLAB_MAX_SIZE bytes)
+	@param[out] err The error that happened
+*/
+POOL_FUNC void pool_slab_static_init(pool_slab_static* p, void* mem, pool_err* err)
+{
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(p == NULL, err, POOL_ERR_INVALID_POOL, );
+	pool_slab_init(&p->slab, mem, POOL_SLAB_MAX_SIZE, POOL_SLAB_PAGE_SIZE, POOL_BUDDY_BLOCK_SIZE, p->meta, err);
+}
+
+/**
+	@fn static void page_freed(pool_slab* p, pool_u page, pool_slab_page_type type, pool_size freed)
+	@brief Updates the state, the index and the counters of a page after frees, its lock must be held
+
+	@param[inout] p The slab struct
+	@param[in] page The page
+	@param[in] type The type of the page before the frees
+	@param[in] freed The number of bytes freed
+*/
+POOL_FUNC static void page_freed(pool_slab* p, pool_u page, pool_slab_page_type type, pool_size freed)
+{
+	pool_size s = pool_buddy_size(p->buddies + page, NULL);
+	pool_slab_page_type to = s == 0 ? EMPTY : (s == p->page_size ? FULL : PARTIAL);
+	set_2_bits(p->slabs, page, to);
+	POOL_LOCK_ACQUIRE(&p->lock);
+	if (s == 0)
+	{
+		order_unlink(p, page);
+		pool_bitmap_set_range(p->empty, page, 1);
+		runs_free(p, page, 1);
+	}
+	else
+		order_link(p, page, pool_buddy_max_order(p->buddies + page, NULL));
+	p->page_count[type]--;
+	p->page_count[to]++;
+	p->used -= freed;
+	POOL_LOCK_RELEASE(&p->lock);
+}
+
+/**
+	@fn static void* slab_malloc(pool_slab* p, pool_size size, pool_u8* retries, pool_err* err)
+	@brief Allocates size bytes in the memory
+
+	A RAW buffer takes the smallest free run that can hold it and gives back the rest of the run,
+	a buffer with no free run large enough takes the first (POOL_SLAB_RAW_FIT) empty pages.
+	A buddy buffer takes a partial page, then the first page of the smallest free run.
+
+	@param[in] p The slab struct
+	@param[in] size The number of bytes to allocate
+	@param[inout] retries Counts the pages that changed before they were locked
+	@param[out] err The error that happened
+*/
+POOL_FUNC static void* slab_malloc(pool_slab* p, pool_size size, pool_u8* retries, pool_err* err)
+{
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(p == NULL, err, POOL_ERR_INVALID_POOL, NULL);
+	pool_u n_pages, page;
+	pool_size s;
+	pool_u8 order, taken;
+	pool_slab_page_type type;
+	void* ret;
+	// RAW Page, its length is kept in raw_n so the buffer is the whole pages
+	if (size > p->page_size)
+	{
+		// Rounding a size larger than the pool to pages could wrap
+		POOL_SET_ERR_IF(size > (pool_size)p->page_n << p->page_shift, err, POOL_ERR_OUT_OF_MEM, NULL);
+		n_pages = (size + p->page_size - 1) >> p->page_shift;
+		POOL_LOCK_ACQUIRE(&p->lock);
+		// The smallest free run that can hold the pages, then any empty pages
+		page = find_free_run(p, n_pages);
+		if (page == p->page_n)
+			page = pool_bitmap_find_run(p->empty, p->page_n, n_pages, POOL_SLAB_RAW_FIT);
+		if (page != p->page_n)
+		{
+			claim_run(p, page, n_pages);
+			p->raw_n[page] = n_pages;
+		}
+		POOL_LOCK_RELEASE(&p->lock);
+		POOL_SET_ERR_IF(page == p->page_n, err, POOL_ERR_OUT_OF_MEM, NULL);
+		return (page << p->page_shift) + (char*)p->mem;
+	}
+	// Page with buddy allocator
+	else
+	{
+		POOL_SET_ERR_IF(size == 0, err, POOL_ERR_INVALID_SIZE, NULL);
+		order = pool_buddy_order(p->buddies, size);
+		for (;;)
+		{
+			POOL_LOCK_ACQUIRE(&p->lock);
+			page = find_order_page(p, order);
+			taken = page == p->page_n;
+			if (taken)
+				page = take_empty_page(p);
+			POOL_LOCK_RELEASE(&p->lock);
+			POOL_SET_ERR_IF(page == p->page_n, err, POOL_ERR_OUT_OF_MEM, NULL);
+			// A partial page may have changed before it is locked, then another one is picked
+			POOL_LOCK_ACQUIRE(&p->buddies[page].lock);
+			type = get_2_bits(p->slabs, page);
+			if (taken || type == PARTIAL)
+			{
+				// Cannot fail on a taken empty page
+				ret = pool_buddy_malloc(p->buddies + page, size, NULL);
+				if (ret != NULL)
+					break;
+			}
+			POOL_LOCK_RELEASE(&p->buddies[page].lock);
+			if (*retries != 0xff)
+				(*retries)++;
+		}
+		s = pool_buddy_size(p->buddies + page, NULL);
+		if (s == p->page_size)
+			set_2_bits(p->slabs, page, FULL);
+		else
+			set_2_bits(p->slabs, page, PARTIAL);
+		POOL_LOCK_ACQUIRE(&p->lock);
+		order_link(p, page, pool_buddy_max_order(p->buddies + page, NULL));
+		p->page_count[type]--;
+		p->page_count[s == p->page_size ? FULL : PARTIAL]++;
+		p->used += (pool_size)1 << (order + p->buddies[page].block_shift);
+		POOL_LOCK_RELEASE(&p->lock);
+		POOL_LOCK_RELEASE(&p->buddies[page].lock);
+		return ret;
+	}
+}
+
+/**
+	@fn void* pool_slab_malloc(pool_slab* p, pool_size size, pool_err* err)
+	@brief Allocates size bytes in the memory
+
+	A RAW buffer takes the smallest free run that can hold it and gives back the rest of the run,
+	a buffer with no free run large enough takes the first (POOL_SLAB_RAW_FIT) empty pages.
+	A buddy buffer takes a partial page, then the first page of the smallest free run.
+
+	@param[in] p The slab struct
+	@param[in] size The number of bytes to allocate
+	@param[out] err The error that happened
+*/
+POOL_FUNC void* pool_slab_malloc(pool_slab* p, pool_size size, pool_err* err)
+{
+	pool_u8 retries = 0;
+	pool_err err2;
+	void* ret;
+	TRACE_START();
+	ret = slab_malloc(p, size, &retries, &err2);
+	TRACE(p, POOL_TRACE_MALLOC, size, ret, retries, err2);
+	POOL_SET_ERR(err, err2);
+	return ret;
+}
+
+/**
+	@fn static void* slab_memalign(pool_slab* p, pool_size align, pool_size size, pool_u8* retries, pool_err* err)
+	@brief Allocates size bytes aligned on align bytes
+
+	A buddy block is aligned on its size in its page, a larger alignment takes a RAW buffer
+	starting on an aligned page. The memory base must be aligned on min(align, page size).
+
+	@param[in] p The slab struct
+	@param[in] align The alignment (power of 2)
+	@param[in] size The number of bytes to allocate
+	@param[inout] retries Counts the pages that changed before they were locked
+	@param[out] err The error that happened
+
+	@return The allocated buffer
+*/
+POOL_FUNC static void* slab_memalign(pool_slab* p, pool_size align, pool_size size, pool_u8* retries, pool_err* err)
+{
+	pool_u n_pages, page, first;
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(p == NULL, err, POOL_ERR_INVALID_POOL, NULL);
+	POOL_SET_ERR_IF(!POOL_IS_POW2(align) || size == 0, err, POOL_ERR_INVALID_SIZE, NULL);
+	// The pages are only as aligned as the memory base
+	POOL_SET_ERR_IF((pool_u)p->mem & ((align < p->page_size ? align : p->page_size) - 1), err, POOL_ERR_INVALID_SIZE, NULL);
+	if (align <= p->page_size)
+		return slab_malloc(p, size < align ? align : size, retries, err);
+
+	POOL_SET_ERR_IF(size > (pool_size)p->page_n << p->page_shift, err, POOL_ERR_OUT_OF_MEM, NULL);
+	n_pages = (size + p->page_size - 1) >> p->page_shift;
+	first = (pool_u)((0 - (pool_u)p->mem) & (align - 1)) >> p->page_shift;
+	POOL_LOCK_ACQUIRE(&p->lock);
+	page = find_aligned_run(p, n_pages, first, (pool_u)(align >> p->page_shift));
+	if (page != p->page_n)
+	{
+		claim_run(p, page, n_pages);
+		p->raw_n[page] = n_pages;
+	}
+	POOL_LOCK_RELEASE(&p->lock);
+	POOL_SET_ERR_IF(page == p->page_n, err, POOL_ERR_OUT_OF_MEM, NULL);
+	return (page << p->page_shift) + (char*)p->mem;
+}
+
+/**
+	@fn void* pool_slab_memalign(pool_slab* p, pool_size align, pool_size size, pool_err* err)
+	@brief Allocates size bytes aligned on align bytes
+
+	A buddy block is aligned on its size in its page, a larger alignment takes a RAW buffer
+	starting on an aligned page. The memory base must be aligned on min(align, page size).
+
+	@param[in] p The slab struct
+	@param[in] align The alignment (power of 2)
+	@param[in] size The number of bytes to allocate
+	@param[out] err The error that happened
+
+	@return The allocated buffer
+*/
+POOL_FUNC void* pool_slab_memalign(pool_slab* p, pool_size align, pool_size size, pool_err* err)
+{
+	pool_u8 retries = 0;
+	pool_err err2;
+	void* ret;
+	TRACE_START();
+	ret = slab_memalign(p, align, size, &retries, &err2);
+	TRACE(p, POOL_TRACE_MALLOC, size, ret, retries, err2);
+	POOL_SET_ERR(err, err2);
+	return ret;
+}
+
+/**
+	@fn static pool_size slab_free(pool_slab* p, void* ptr, pool_err* err)
+	@brief Frees a previously allocated buffer
+
+	@param[in] p The slab struct
+	@param[in] ptr The buffer to free
+	@param[out] err The error that happened
+
+	@return The number of bytes freed
+*/
+POOL_FUNC static pool_size slab_free(pool_slab* p, void* ptr, pool_err* err)
+{
+	pool_u page;
+	pool_slab_page_type type;
+	pool_size s, freed;
+	pool_err err2;
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	if (ptr == NULL)
+		return 0;
+	POOL_SET_ERR_IF(p == NULL, err, POOL_ERR_INVALID_POOL, 0);
+	POOL_SET_ERR_IF(ptr < p->mem || (char*)ptr >= (char*)p->mem + (p->page_n << p->page_shift), err, POOL_ERR_INVALID_PTR, 0);
+	page = ((pool_u)ptr - (pool_u)p->mem) >> p->page_shift;
+	type = get_2_bits(p->slabs, page);
+	POOL_SET_ERR_IF(type == EMPTY, err, POOL_ERR_INVALID_PTR, 0);
+	if (type == PARTIAL || type == FULL)
+	{
+		POOL_LOCK_ACQUIRE(&p->buddies[page].lock);
+		type = get_2_bits(p->slabs, page);
+		err2 = POOL_ERR_INVALID_PTR;
+		freed = pool_buddy_size(p->buddies + page, NULL);
+		if (type == PARTIAL || type == FULL)
+			pool_buddy_free(p->buddies + page, ptr, &err2);
+		if (err2 != POOL_ERR_OK)
+		{
+			POOL_LOCK_RELEASE(&p->buddies[page].lock);
+			POOL_SET_ERR(err, err2);
+			return 0;
+		}
+		freed -= pool_buddy_size(p->buddies + page, NULL);
+		page_freed(p, page, type, freed);
+		POOL_LOCK_RELEASE(&p->buddies[page].lock);
+		return freed;
+	}
+	else
+	{
+		POOL_SET_ERR_IF(ptr != (char*)p->mem + (page << p->page_shift), err, POOL_ERR_INVALID_PTR, 0);
+		POOL_LOCK_ACQUIRE(&p->lock);
+		s = p->raw_n[page];
+		if (s == 0)
+		{
+			POOL_LOCK_RELEASE(&p->lock);
+			POOL_SET_ERR(err, POOL_ERR_INVALID_PTR);
+			return 0;
+		}
+		p->raw_n[page] = 0;
+		release_run(p, page, (pool_u)s);
+		POOL_LOCK_RELEASE(&p->lock);
+		return s << p->page_shift;
+	}
+}
+
+/**
+	@fn void pool_slab_free(pool_slab* p, void* ptr, pool_err* err)
+	@brief Frees a previously allocated buffer
+
+	@param[in] p The slab struct
+	@param[in] ptr The buffer to free
+	@param[out] err The error that happened
+*/
+POOL_FUNC void pool_slab_free(pool_slab* p, void* ptr, pool_err* err)
+{
+	pool_err err2;
+	pool_size freed;
+	TRACE_START();
+	freed = slab_free(p, ptr, &err2);
+	TRACE(p, POOL_TRACE_FREE, freed, ptr, 0, err2);
+	POOL_SET_ERR(err, err2);
+}
+
+/**
+	@fn pool_u pool_slab_malloc_batch(pool_slab* p, pool_size size, pool_u n, void** out, pool_err* err)
+	@brief Allocates n buffers of size bytes, each page is filled before moving to the next one
+
+	@param[inout] p The slab struct
+	@param[in] size The size of a buffer
+	@param[in] n The number of buffers
+	@param[out] out The allocated buffers
+	@param[out] err The error that happened (POOL_ERR_OUT_OF_MEM if less than n buffers were allocated)
+
+	@return The number of allocated buffers, they are at the start of out
+*/
+POOL_FUNC pool_u pool_slab_malloc_batch(pool_slab* p, pool_size size, pool_u n, void** out, pool_err* err)
+{
+	pool_u done = 0;
+	pool_u page, start;
+	pool_size s;
+	pool_u8 order, taken;
+	pool_slab_page_type type;
+	TRACE_START();
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(p == NULL, err, POOL_ERR_INVALID_POOL, 0);
+	POOL_SET_ERR_IF(out == NULL && n != 0, err, POOL_ERR_INVALID_PTR, 0);
+	POOL_SET_ERR_IF(size == 0, err, POOL_ERR_INVALID_SIZE, 0);
+	// RAW Pages, every buffer has its own pages
+	if (size > p->page_size)
+	{
+		while (done < n && (out[done] = pool_slab_malloc(p, size, NULL)) != NULL)
+			done++;
+	}
+	// Pages with buddy allocator
+	else
+	{
+		order = pool_buddy_order(p->buddies, size);
+		while (done < n)
+		{
+			POOL_LOCK_ACQUIRE(&p->lock);
+			page = find_order_page(p, order);
+			taken = page == p->page_n;
+			if (taken)
+				page = take_empty_page(p);
+			POOL_LOCK_RELEASE(&p->lock);
+			if (page == p->page_n)
+				break;
+			// A partial page may have changed before it is locked, then another one is picked
+			POOL_LOCK_ACQUIRE(&p->buddies[page].lock);
+			type = get_2_bits(p->slabs, page);
+			start = done;
+			if (taken || type == PARTIAL)
+			{
+				while (done < n && (out[done] = pool_buddy_malloc(p->buddies + page, size, NULL)) != NULL)
+					done++;
+			}
+			if (done == start)
+			{
+				POOL_LOCK_RELEASE(&p->buddies[page].lock);
+				continue;
+			}
+			// The page state and the index are updated once for the page
+			s = pool_buddy_size(p->buddies + page, NULL);
+			set_2_bits(p->slabs, page, s == p->page_size ? FULL : PARTIAL);
+			POOL_LOCK_ACQUIRE(&p->lock);
+			order_link(p, page, pool_buddy_max_order(p->buddies + page, NULL));
+			p->page_count[type]--;
+			p->page_count[s == p->page_size ? FULL : PARTIAL]++;
+			p->used += (pool_size)(done - start) << (order + p->buddies[page].block_shift);
+			POOL_LOCK_RELEASE(&p->lock);
+			POOL_LOCK_RELEASE(&p->buddies[page].lock);
+			TRACE_BATCH(p, POOL_TRACE_MALLOC, size, out + start, done - start, POOL_ERR_OK);
+		}
+	}
+	// The buffers that could not be allocated are one failure (pool_slab_malloc traced the RAW one)
+	if (done != n && size <= p->page_size)
+		TRACE(p, POOL_TRACE_MALLOC, size, NULL, 0, POOL_ERR_OUT_OF_MEM);
+	POOL_SET_ERR_IF(done != n, err, POOL_ERR_OUT_OF_MEM, done);
+	return done;
+}
+
+/**
+	@fn static void sift_down(void** ptrs, pool_u i, pool_u n)
+	@brief Moves a pointer down a max heap of pointers until its children are below it
 
-	@return The type of page
+	@param[inout] ptrs The heap
+	@param[in] i The position of the pointer
+	@param[in] n The number of pointers in the heap
 */
-POOL_FUNC static pool_slab_page_type get_2_bits(pool_u8* buf, pool_u at)
+POOL_FUNC static void sift_down(void** ptrs, pool_u i, pool_u n)
 {
-	return (pool_slab_page_type)((POOL_GET_BIT(buf, 2 * at) << 1) | POOL_GET_BIT(buf, 2 * at + 1));
+	pool_u child;
+	void* ptr = ptrs[i];
+	for (child = 2 * i + 1; child < n; i = child, child = 2 * i + 1)
+	{
+		if (child + 1 < n && (pool_u)ptrs[child + 1] > (pool_u)ptrs[child])
+			child++;
+		if ((pool_u)ptrs[child] <= (pool_u)ptr)
+			break;
+		ptrs[i] = ptrs[child];
+	}
+	ptrs[i] = ptr;
 }
 
 /**
-	@fn static void set_2_bits(char* buf, pool_u at, pool_slab_page_type type)
-	@brief Sets the type at the index
+	@fn static void sort_ptrs(void** ptrs, pool_u n)
+	@brief Sorts pointers by address in place (heapsort, no recursion and no memory)
 
-	@param buf the slab array
-	@param at The index
-	@param type The type to set
+	@param[inout] ptrs The pointers
+	@param[in] n The number of pointers
 */
-POOL_FUNC static void set_2_bits(pool_u8* buf, pool_u at, pool_slab_page_type type)
+POOL_FUNC static void sort_ptrs(void** ptrs, pool_u n)
 {
-	switch (type)
+	pool_u i;
+	void* ptr;
+	for (i = n / 2; i > 0; i--)
+		sift_down(ptrs, i - 1, n);
+	for (i = n; i > 1; i--)
 	{
-	case EMPTY:
-		POOL_UST_BIT(buf, 2 * at);
-		POOL_UST_BIT(buf, 2 * at + 1);
-		break;
-	case PARTIAL:
-		POOL_UST_BIT(buf, 2 * at);
-		POOL_SET_BIT(buf, 2 * at + 1);
-		break;
-	case FULL:
-		POOL_SET_BIT(buf, 2 * at);
-		POOL_UST_BIT(buf, 2 * at + 1);
-		break;
-	case RAW:
-		POOL_SET_BIT(buf, 2 * at);
-		POOL_SET_BIT(buf, 2 * at + 1);
-		break;
+		ptr = ptrs[0];
+		ptrs[0] = ptrs[i - 1];
+		ptrs[i - 1] = ptr;
+		sift_down(ptrs, 0, i - 1);
 	}
 }
 
 /**
-	@fn void pool_slab_init(pool_slab* p, void* mem, pool_err* err)
-	@brief Initializes the slab pool
+	@fn void pool_slab_free_batch(pool_slab* p, void** ptrs, pool_u n, pool_err* err)
+	@brief Frees n buffers, the buffers of a page are freed together
+
+	The buffers are sorted by address first, so each page is locked once.
 
 	@param[inout] p The slab struct
-	@param[in] mem The memory base
+	@param[inout] ptrs The buffers (NULL entries are skipped), sorted by address on return
+	@param[in] n The number of buffers
+	@param[out] err The error that happened (the other buffers are still freed)
+*/
+POOL_FUNC void pool_slab_free_batch(pool_slab* p, void** ptrs, pool_u n, pool_err* err)
+{
+	pool_u i, j, page;
+	pool_slab_page_type type;
+	pool_size freed, left, s;
+	pool_err err2;
+	TRACE_START();
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(p == NULL, err, POOL_ERR_INVALID_POOL, );
+	POOL_SET_ERR_IF(ptrs == NULL && n != 0, err, POOL_ERR_INVALID_PTR, );
+	// The buffers of a page are next to each other
+	sort_ptrs(ptrs, n);
+	for (i = 0; i < n; i = j)
+	{
+		j = i + 1;
+		if (ptrs[i] == NULL)
+			continue;
+		page = page_of(p, ptrs[i]);
+		if (page == p->page_n)
+		{
+			TRACE(p, POOL_TRACE_FREE, 0, ptrs[i], 0, POOL_ERR_INVALID_PTR);
+			POOL_SET_ERR(err, POOL_ERR_INVALID_PTR);
+			continue;
+		}
+		type = get_2_bits(p->slabs, page);
+		if (type != PARTIAL && type != FULL)
+		{
+			pool_slab_free(p, ptrs[i], &err2);
+			if (err2 != POOL_ERR_OK)
+				POOL_SET_ERR(err, err2);
+			continue;
+		}
+
+		POOL_LOCK_ACQUIRE(&p->buddies[page].lock);
+		type = get_2_bits(p->slabs, page);
+		if (type != PARTIAL && type != FULL)
+		{
+			POOL_LOCK_RELEASE(&p->buddies[page].lock);
+			TRACE(p, POOL_TRACE_FREE, 0, ptrs[i], 0, POOL_ERR_INVALID_PTR);
+			POOL_SET_ERR(err, POOL_ERR_INVALID_PTR);
+			continue;
+		}
+		freed = pool_buddy_size(p->buddies + page, NULL);
+		left = freed;
+		for (j = i; j < n && page_of(p, ptrs[j]) == page; j++)
+		{
+			pool_buddy_free(p->buddies + page, ptrs[j], &err2);
+			if (err2 != POOL_ERR_OK)
+				POOL_SET_ERR(err, err2);
+			s = pool_buddy_size(p->buddies + page, NULL);
+			TRACE(p, POOL_TRACE_FREE, left - s, ptrs[j], 0, err2);
+			left = s;
+		}
+		// The page state and the index are updated once for the page
+		page_freed(p, page, type, freed - left);
+		POOL_LOCK_RELEASE(&p->buddies[page].lock);
+	}
+}
+
+/**
+	@fn static void slab_free_sized(pool_slab* p, void* ptr, pool_size size, pool_err* err)
+	@brief Frees a buffer of a known size, skips the search of its block
+
+	ptr and size are only checked when POOL_DEBUG is defined.
+
+	@param[in] p The slab struct
+	@param[in] ptr The buffer to free
+	@param[in] size The size given to malloc, realloc or memalign (for memalign on at most a page, the alignment if it is larger)
 	@param[out] err The error that happened
 */
-POOL_FUNC void pool_slab_init(pool_slab* p, void* mem, pool_err* err)
+POOL_FUNC static void slab_free_sized(pool_slab* p, void* ptr, pool_size size, pool_err* err)
 {
-	pool_u i;
+	pool_u page;
+	pool_slab_page_type type;
+	pool_err err2;
 	POOL_SET_ERR(err, POOL_ERR_OK);
+	if (ptr == NULL)
+		return;
 	POOL_SET_ERR_IF(p == NULL, err, POOL_ERR_INVALID_POOL, );
-	POOL_SET_ERR_IF(mem == NULL, err, POOL_ERR_INVALID_PTR, );
-	p->mem = mem;
-	for (i = 0; i < POOL_SLAB_SLAB_SIZE; i++)
-		p->slabs[i] = 0x00;
-	for (i = 0; i < POOL_SLAB_PAGE_N; i++)
+#ifdef POOL_DEBUG
+	POOL_SET_ERR_IF(page_of(p, ptr) == p->page_n, err, POOL_ERR_INVALID_PTR, );
+#endif
+	page = ((pool_u)ptr - (pool_u)p->mem) >> p->page_shift;
+	// A RAW buffer has its length in the metadata, there is nothing to search (it can be smaller than a page after realloc)
+	if (get_2_bits(p->slabs, page) == RAW)
 	{
-		pool_buddy_init(p->buddies + i, (char*)mem + i*POOL_SLAB_PAGE_SIZE, err);
-		POOL_SET_ERR_IF(err ? *err : 0, err, *err, );
+#ifdef POOL_DEBUG
+		POOL_SET_ERR_IF(p->raw_n[page] != (size + p->page_size - 1) >> p->page_shift, err, POOL_ERR_INVALID_SIZE, );
+#endif
+		slab_free(p, ptr, err);
+		return;
+	}
+	POOL_LOCK_ACQUIRE(&p->buddies[page].lock);
+	type = get_2_bits(p->slabs, page);
+#ifdef POOL_DEBUG
+	if ((type != PARTIAL && type != FULL) || size > p->page_size)
+	{
+		POOL_LOCK_RELEASE(&p->buddies[page].lock);
+		POOL_SET_ERR(err, POOL_ERR_INVALID_PTR);
+		return;
 	}
+#endif
+	pool_buddy_free_sized(p->buddies + page, ptr, size, &err2);
+	if (err2 != POOL_ERR_OK)
+	{
+		POOL_LOCK_RELEASE(&p->buddies[page].lock);
+		POOL_SET_ERR(err, err2);
+		return;
+	}
+	page_freed(p, page, type, (pool_size)1 << (pool_buddy_order(p->buddies + page, size) + p->buddies[page].block_shift));
+	POOL_LOCK_RELEASE(&p->buddies[page].lock);
 }
 
-POOL_FUNC static pool_u find_empty_page(pool_u8* slabs, pool_u n_pages)
+/**
+	@fn void pool_slab_free_sized(pool_slab* p, void* ptr, pool_size size, pool_err* err)
+	@brief Frees a buffer of a known size, skips the search of its block
+
+	ptr and size are only checked when POOL_DEBUG is defined.
+
+	@param[in] p The slab struct
+	@param[in] ptr The buffer to free
+	@param[in] size The size given to malloc, realloc or memalign (for memalign on at most a page, the alignment if it is larger)
+	@param[out] err The error that happened
+*/
+POOL_FUNC void pool_slab_free_sized(pool_slab* p, void* ptr, pool_size size, pool_err* err)
 {
-	pool_u i, j;
-	pool_u8 ok;
-	for (i = 0; i < POOL_SLAB_PAGE_N - n_pages; i++)
+	pool_err err2;
+	TRACE_START();
+	slab_free_sized(p, ptr, size, &err2);
+	TRACE(p, POOL_TRACE_FREE, size, ptr, 0, err2);
+	POOL_SET_ERR(err, err2);
+}
+
+/**
+	@fn static void copy_bytes(void* dst, const void* src, pool_size n)
+	@brief Copies n bytes
+
+	@param[out] dst The destination
+	@param[in] src The source
+	@param[in] n The number of bytes
+*/
+POOL_FUNC static void copy_bytes(void* dst, const void* src, pool_size n)
+{
+	pool_size i;
+	for (i = 0; i < n; i++)
+		((char*)dst)[i] = ((const char*)src)[i];
+}
+
+/**
+	@fn static pool_u8 resize_buddy(pool_slab* p, pool_u page, void* ptr, pool_size size, pool_size* old_size, pool_err* err)
+	@brief Resizes a buddy allocation in its page
+
+	@param[inout] p The slab struct
+	@param[in] page The page of the buffer
+	@param[in] ptr The buffer
+	@param[in] size The new size
+	@param[out] old_size The size of the block of the buffer
+	@param[out] err The error that happened
+
+	@return 1 if the buffer was resized in place
+*/
+POOL_FUNC static pool_u8 resize_buddy(pool_slab* p, pool_u page, void* ptr, pool_size size, pool_size* old_size, pool_err* err)
+{
+	pool_buddy* b = p->buddies + page;
+	pool_slab_page_type type;
+	pool_size before, after;
+	pool_u8 order, done = 0;
+	POOL_LOCK_ACQUIRE(&b->lock);
+	type = get_2_bits(p->slabs, page);
+	order = POOL_BUDDY_ORDER_NONE;
+	if (type == PARTIAL || type == FULL)
+		order = pool_buddy_block_order(b, ptr, NULL);
+	if (order == POOL_BUDDY_ORDER_NONE)
 	{
-		ok = 1;
-		for (j = i; j < n_pages + i; j++)
-		{
-			if (get_2_bits(slabs, j) != EMPTY)
-			{
-				ok = 0;
-				break;
-			}
-		}
-		if (ok)
-			return i;
+		POOL_LOCK_RELEASE(&b->lock);
+		POOL_SET_ERR(err, POOL_ERR_INVALID_PTR);
+		return 0;
+	}
+	*old_size = (pool_size)1 << (order + b->block_shift);
+	before = pool_buddy_size(b, NULL);
+	if (size <= p->page_size && pool_buddy_resize(b, ptr, size, NULL))
+	{
+		after = pool_buddy_size(b, NULL);
+		set_2_bits(p->slabs, page, after == p->page_size ? FULL : PARTIAL);
+		POOL_LOCK_ACQUIRE(&p->lock);
+		order_link(p, page, pool_buddy_max_order(b, NULL));
+		p->page_count[type]--;
+		p->page_count[after == p->page_size ? FULL : PARTIAL]++;
+		p->used += after - before;
+		POOL_LOCK_RELEASE(&p->lock);
+		done = 1;
 	}
-	return POOL_SLAB_PAGE_N;
+	POOL_LOCK_RELEASE(&b->lock);
+	return done;
 }
 
-POOL_FUNC static pool_u find_page(pool_slab* p, pool_size size, pool_size from, pool_size to)
+/**
+	@fn static pool_u8 resize_raw(pool_slab* p, pool_u page, pool_size size, pool_size* old_size, pool_err* err)
+	@brief Resizes a RAW allocation by taking the next empty pages or giving back its last pages
+
+	@param[inout] p The slab struct
+	@param[in] page The first page of the buffer
+	@param[in] size The new size
+	@param[out] old_size The size of the buffer
+	@param[out] err The error that happened
+
+	@return 1 if the buffer was resized in place
+*/
+POOL_FUNC static pool_u8 resize_raw(pool_slab* p, pool_u page, pool_size size, pool_size* old_size, pool_err* err)
 {
-	pool_u i;
-	for (i = from; i < to; i++)
+	pool_u n_pages;
+	pool_u new_pages = (size + p->page_size - 1) >> p->page_shift;
+	// A wrapped size would release the whole run
+	if (new_pages == 0)
+		return 0;
+	POOL_LOCK_ACQUIRE(&p->lock);
+	n_pages = p->raw_n[page];
+	if (n_pages == 0)
 	{
-		pool_slab_page_type type = get_2_bits(p->slabs, i);
-		if (type == EMPTY || type == PARTIAL)
+		POOL_LOCK_RELEASE(&p->lock);
+		POOL_SET_ERR(err, POOL_ERR_INVALID_PTR);
+		return 0;
+	}
+	*old_size = n_pages << p->page_shift;
+	if (new_pages > n_pages)
+	{
+		if (new_pages > p->page_n - page || pool_bitmap_next_clear(p->empty, page + new_pages, page + n_pages) != page + new_pages)
 		{
-			pool_u s = p->buddies[i].allocated;
-			if (POOL_SLAB_PAGE_SIZE - s >= size)
-				return i;
+			POOL_LOCK_RELEASE(&p->lock);
+			return 0;
 		}
+		claim_run(p, page + n_pages, new_pages - n_pages);
 	}
-	return POOL_SLAB_PAGE_N;
+	else if (new_pages < n_pages)
+		release_run(p, page + new_pages, n_pages - new_pages);
+	p->raw_n[page] = new_pages;
+	POOL_LOCK_RELEASE(&p->lock);
+	return 1;
 }
 
 /**
-	@fn void* pool_slab_malloc(pool_slab* p, pool_size size, pool_err* err)
-	@brief Allocates size bytes in the memory
+	@fn static void* slab_realloc(pool_slab* p, void* ptr, pool_size size, pool_u8* retries, pool_size* freed, pool_err* err)
+	@brief Resizes a buffer, in place when possible
 
-	@param[in] p The slab struct
-	@param[in] size The number of bytes to allocate
+	A buddy buffer grows into its free buddies and shrinks by splitting, a RAW buffer grows
+	into the next empty pages and gives back its last pages. Otherwise the buffer is moved.
+
+	@param[inout] p The slab struct
+	@param[in] ptr The buffer (NULL to allocate)
+	@param[in] size The new size (0 to free)
+	@param[inout] retries Counts the pages that changed before they were locked
+	@param[out] freed The bytes freed with ptr when it was moved or freed, 0 otherwise
 	@param[out] err The error that happened
+
+	@return The resized buffer, NULL on failure (ptr is still valid)
 */
-POOL_FUNC void* pool_slab_malloc(pool_slab* p, pool_size size, pool_err* err)
+POOL_FUNC static void* slab_realloc(pool_slab* p, void* ptr, pool_size size, pool_u8* retries, pool_size* freed, pool_err* err)
 {
+	pool_u page;
+	pool_slab_page_type type;
+	pool_size old_size = 0;
+	pool_u8 done;
+	pool_err err2 = POOL_ERR_OK;
+	void* ret;
+	*freed = 0;
 	POOL_SET_ERR(err, POOL_ERR_OK);
 	POOL_SET_ERR_IF(p == NULL, err, POOL_ERR_INVALID_POOL, NULL);
-	pool_u n_pages, page;
-	pool_u i = 0;
-	pool_size s;
-	pool_err err2;
-	// RAW Page
-	if (size > POOL_SLAB_PAGE_SIZE)
-	{
-		n_pages = POOL_CEIL_DIV(size + sizeof(pool_u), POOL_SLAB_PAGE_SIZE);
-		page = find_empty_page(p->slabs, n_pages);
-		POOL_SET_ERR_IF(page == POOL_SLAB_PAGE_N, err, POOL_ERR_OUT_OF_MEM, NULL);
-		for (i = page; i < page + n_pages; i++)
-			set_2_bits(p->slabs, i, RAW);
-		void* ret = page*POOL_SLAB_PAGE_SIZE + (char*)p->mem;
-		*((pool_u*)ret) = n_pages;
-		ret = (char*)ret + sizeof(pool_u);
-		return ret;
+	if (ptr == NULL)
+		return slab_malloc(p, size, retries, err);
+	if (size == 0)
+	{
+		*freed = slab_free(p, ptr, err);
+		return NULL;
 	}
-	// Page with buddy allocator
-	else
+	POOL_SET_ERR_IF(ptr < p->mem || (char*)ptr >= (char*)p->mem + (p->page_n << p->page_shift), err, POOL_ERR_INVALID_PTR, NULL);
+	// Rounding a size larger than the pool to pages could wrap
+	POOL_SET_ERR_IF(size > (pool_size)p->page_n << p->page_shift, err, POOL_ERR_OUT_OF_MEM, NULL);
+	page = ((pool_u)ptr - (pool_u)p->mem) >> p->page_shift;
+	type = get_2_bits(p->slabs, page);
+	POOL_SET_ERR_IF(type == EMPTY, err, POOL_ERR_INVALID_PTR, NULL);
+	if (type == RAW)
 	{
-		page = 0;
-		while(page < POOL_SLAB_PAGE_N)
-		{
-			page = find_page(p, size, page, POOL_SLAB_PAGE_N);
-			void* ret = pool_buddy_malloc(p->buddies + page, size, &err2);
-			if(!err2)
-			{
-				s = p->buddies[page].allocated*POOL_BUDDY_BLOCK_SIZE;
-				POOL_SET_ERR_IF(err ? *err : 0, err, *err, NULL);
-				if (s == POOL_SLAB_PAGE_SIZE)
-					set_2_bits(p->slabs, page, FULL);
-				else
-					set_2_bits(p->slabs, page, PARTIAL);
-				return ret;
-			}
-			page++;
-		}
-		POOL_SET_ERR(err, POOL_ERR_OUT_OF_MEM);
+		POOL_SET_ERR_IF(ptr != (char*)p->mem + (page << p->page_shift), err, POOL_ERR_INVALID_PTR, NULL);
+		done = resize_raw(p, page, size, &old_size, &err2);
 	}
-	return NULL;
+	else
+		done = resize_buddy(p, page, ptr, size, &old_size, &err2);
+	POOL_SET_ERR_IF(err2 != POOL_ERR_OK, err, err2, NULL);
+	if (done)
+		return ptr;
+
+	// Moves the buffer
+	ret = slab_malloc(p, size, retries, err);
+	if (ret == NULL)
+		return NULL;
+	copy_bytes(ret, ptr, old_size < size ? old_size : size);
+	*freed = slab_free(p, ptr, err);
+	return ret;
 }
 
 /**
-	@fn void pool_slab_free(pool_slab* p, void* ptr, pool_err* err)
-	@brief Frees a previously allocated buffer
+	@fn void* pool_slab_realloc(pool_slab* p, void* ptr, pool_size size, pool_err* err)
+	@brief Resizes a buffer, in place when possible
+
+	A buddy buffer grows into its free buddies and shrinks by splitting, a RAW buffer grows
+	into the next empty pages and gives back its last pages. Otherwise the buffer is moved.
+
+	@param[inout] p The slab struct
+	@param[in] ptr The buffer (NULL to allocate)
+	@param[in] size The new size (0 to free)
+	@param[out] err The error that happened
+
+	@return The resized buffer, NULL on failure (ptr is still valid)
+*/
+POOL_FUNC void* pool_slab_realloc(pool_slab* p, void* ptr, pool_size size, pool_err* err)
+{
+	pool_u8 retries = 0;
+	pool_size freed;
+	pool_err err2;
+	void* ret;
+	TRACE_START();
+	ret = slab_realloc(p, ptr, size, &retries, &freed, &err2);
+	// A size of 0 is only a free, a moved buffer is followed by the free of the old one
+	if (ptr == NULL || size != 0)
+		TRACE(p, POOL_TRACE_REALLOC, size, ret, retries, err2);
+	if (ptr != NULL && (size == 0 || freed != 0))
+		TRACE(p, POOL_TRACE_FREE, freed, ptr, 0, err2);
+	POOL_SET_ERR(err, err2);
+	return ret;
+}
+
+/**
+	@fn pool_u8 pool_slab_block_order(pool_slab* p, void* ptr, pool_err* err)
+	@brief Finds the buddy order of an allocated buffer
+
+	Reads the page type and the buddy tree of the page, which the other buffers of the page change: with POOL_CONCURRENT
+	the page lock is taken, otherwise the call must be serialized with the other operations on the pool.
 
 	@param[in] p The slab struct
-	@param[in] ptr The buffer to free
+	@param[in] ptr The allocated buffer
 	@param[out] err The error that happened
 
-	@return The allocated buffer
+	@return The order of the buffer, POOL_BUDDY_ORDER_NONE for a RAW buffer
 */
-POOL_FUNC void pool_slab_free(pool_slab* p, void* ptr, pool_err* err)
+POOL_FUNC pool_u8 pool_slab_block_order(pool_slab* p, void* ptr, pool_err* err)
 {
 	pool_u page;
 	pool_slab_page_type type;
-	pool_size s;
-	pool_u i = 0;
+	pool_u8 order;
 	POOL_SET_ERR(err, POOL_ERR_OK);
-	if (ptr == NULL)
-		return;
-	POOL_SET_ERR_IF(p == NULL, err, POOL_ERR_INVALID_POOL, );
-	POOL_SET_ERR_IF(ptr < p->mem || (char*)ptr > (char*)p->mem + POOL_SLAB_MAX_SIZE, err, POOL_ERR_INVALID_PTR,);
-	page = ((pool_u)ptr - (pool_u)p->mem) / POOL_SLAB_PAGE_SIZE;
+	POOL_SET_ERR_IF(p == NULL, err, POOL_ERR_INVALID_POOL, POOL_BUDDY_ORDER_NONE);
+	POOL_SET_ERR_IF(ptr < p->mem || (char*)ptr >= (char*)p->mem + (p->page_n << p->page_shift), err, POOL_ERR_INVALID_PTR, POOL_BUDDY_ORDER_NONE);
+	page = ((pool_u)ptr - (pool_u)p->mem) >> p->page_shift;
 	type = get_2_bits(p->slabs, page);
-	POOL_SET_ERR_IF(type == EMPTY, err, POOL_ERR_INVALID_PTR, );
-	if (type == PARTIAL || type == FULL)
+	POOL_SET_ERR_IF(type == EMPTY, err, POOL_ERR_INVALID_PTR, POOL_BUDDY_ORDER_NONE);
+	if (type == RAW)
+		return POOL_BUDDY_ORDER_NONE;
+	POOL_LOCK_ACQUIRE(&p->buddies[page].lock);
+	order = pool_buddy_block_order(p->buddies + page, ptr, err);
+	POOL_LOCK_RELEASE(&p->buddies[page].lock);
+	return order;
+}
+
+/**
+	@fn void pool_slab_stat(pool_slab* p, pool_slab_stats* stats, pool_err* err)
+	@brief Stats the slab pool
+
+	@param[in] p The slab struct
+	@param[out] stats The stats
+	@param[out] err The error that happened
+*/
+POOL_FUNC void pool_slab_stat(pool_slab* p, pool_slab_stats* stats, pool_err* err)
+{
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(p == NULL, err, POOL_ERR_INVALID_POOL, );
+	POOL_SET_ERR_IF(stats == NULL, err, POOL_ERR_INVALID_PTR, );
+#ifdef POOL_DEBUG
+	pool_slab_verify(p, err);
+	POOL_SET_ERR_IF(err ? *err : 0, err, *err, );
+#endif
+	stats->size = p->page_n << p->page_shift;
+	stats->n_pages = p->page_n;
+	POOL_LOCK_ACQUIRE(&p->lock);
+	stats->n_pages_empty = p->page_count[EMPTY];
+	stats->n_pages_partial = p->page_count[PARTIAL];
+	stats->n_pages_full = p->page_count[FULL];
+	stats->n_pages_raw = p->page_count[RAW];
+	stats->n_pages_decommitted = p->decommitted_n;
+	stats->resident = stats->size - (p->decommitted_n << p->page_shift);
+	stats->used = p->used;
+	POOL_LOCK_RELEASE(&p->lock);
+}
+
+/**
+	@fn pool_u pool_slab_reclaim(pool_slab* p, pool_u delay, pool_u keep, pool_decommit decommit, void* data, pool_err* err)
+	@brief Gives back to the system the empty pages that stayed empty for delay passes
+
+	To be called periodically, each call is a pass. A page is decommitted once it stayed empty for delay whole passes,
+	the first keep resident empty pages (in address order) are always kept, so the pages that are freed and reused
+	between two passes stay resident. A decommitted page is used again as is, the system gives it back on first touch.
+	Walks the empty pages bitmap and calls decommit with the index lock held. Only the pages inside the pieces
+	decommit reports are counted as decommitted, the others are given to decommit again by the next passes.
+
+	@param[inout] p The slab struct
+	@param[in] delay The number of whole passes a page must stay empty (0 for every page that was empty before the call)
+	@param[in] keep The number of resident empty pages never decommitted
+	@param[in] decommit Gives the pages back (pool_os_decommit for memory from mmap or VirtualAlloc)
+	@param[in] data The data passed to decommit
+	@param[out] err The error that happened
+
+	@return The number of pages decommitted by this pass
+*/
+POOL_FUNC pool_u pool_slab_reclaim(pool_slab* p, pool_u delay, pool_u keep, pool_decommit decommit, void* data, pool_err* err)
+{
+	pool_u i, end, start, from, to;
+	pool_size unit;
+	pool_u kept = 0;
+	pool_u n = 0;
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(p == NULL, err, POOL_ERR_INVALID_POOL, 0);
+	POOL_SET_ERR_IF(decommit == NULL, err, POOL_ERR_INVALID_PTR, 0);
+	POOL_LOCK_ACQUIRE(&p->lock);
+	p->epoch++;
+	for (i = pool_bitmap_next_set(p->empty, p->page_n, 0); i < p->page_n; i = pool_bitmap_next_set(p->empty, p->page_n, end))
 	{
-		pool_buddy_free(p->buddies + page, ptr, err);
-		POOL_SET_ERR_IF(err ? *err : 0, err, *err, );
-		s = p->buddies[page].allocated*POOL_BUDDY_BLOCK_SIZE;
-		POOL_SET_ERR_IF(err ? *err : 0, err, *err, );
-		if (s == 0)
-			set_2_bits(p->slabs, page, EMPTY);
-		else
-			set_2_bits(p->slabs, page, PARTIAL);
+		end = pool_bitmap_next_clear(p->empty, p->page_n, i);
+		// Each stretch of idle resident pages is given back with one call
+		for (start = i; i <= end; i++)
+		{
+			if (i < end && !POOL_BITMAP_GET(p->decommitted, i))
+			{
+				if (kept < keep)
+					kept++;
+				else if (p->epoch - p->empty_since[i] > delay)
+					continue;
+			}
+			if (start < i)
+			{
+				unit = decommit(data, (char*)p->mem + (start << p->page_shift), (i - start) << p->page_shift);
+				// Only the pages inside the pieces that were given back (a piece may be larger than a page)
+				from = unit == 0 ? i : (POOL_ALIGN_UP((pool_u)p->mem + (start << p->page_shift), unit) - (pool_u)p->mem + p->page_size - 1) >> p->page_shift;
+				to = unit == 0 ? i : ((((pool_u)p->mem + (i << p->page_shift)) & ~(unit - 1)) - (pool_u)p->mem) >> p->page_shift;
+				if (from < to)
+				{
+					pool_bitmap_set_range(p->decommitted, from, to - from);
+					p->decommitted_n += to - from;
+					n += to - from;
+				}
+			}
+			start = i + 1;
+		}
 	}
+	POOL_LOCK_RELEASE(&p->lock);
+	return n;
+}
+
+/**
+	@fn void pool_slab_frag(pool_slab* p, pool_slab_frag_stats* stats, pool_err* err)
+	@brief Reports the fragmentation of the slab pool
+
+	Copies the order list and free run counters and scans the empty pages bitmap for the longest run,
+	no page is visited, so it can be called often.
+
+	@param[in] p The slab struct
+	@param[out] stats The fragmentation report
+	@param[out] err The error that happened
+*/
+POOL_FUNC void pool_slab_frag(pool_slab* p, pool_slab_frag_stats* stats, pool_err* err)
+{
+	pool_u i, end;
+	pool_u8 block_shift;
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(p == NULL, err, POOL_ERR_INVALID_POOL, );
+	POOL_SET_ERR_IF(stats == NULL, err, POOL_ERR_INVALID_PTR, );
+	block_shift = p->buddies[0].block_shift;
+	stats->longest_run = 0;
+	POOL_LOCK_ACQUIRE(&p->lock);
+	stats->free = (p->page_n << p->page_shift) - p->used;
+	for (i = 0; i < POOL_BUDDY_ORDER_MAX; i++)
+		stats->pages_by_order[i] = p->order_count[i];
+	for (i = 0; i < POOL_SLAB_RUN_ORDER_MAX; i++)
+		stats->runs_by_order[i] = p->run_count[i];
+	if (p->run_mask != 0)
+		stats->largest_block = p->page_size;
+	else if (p->order_mask != 0)
+		stats->largest_block = (pool_size)1 << (block_shift + (sizeof(pool_u) * 8 - 1 - POOL_CLZ(p->order_mask)));
 	else
+		stats->largest_block = 0;
+	// Each run of empty pages is two bitmap scans
+	for (i = pool_bitmap_next_set(p->empty, p->page_n, 0); i < p->page_n; i = pool_bitmap_next_set(p->empty, p->page_n, end))
 	{
-		POOL_SET_ERR_IF(ptr == (char*)p->mem + page*POOL_SLAB_PAGE_SIZE, err, POOL_ERR_INVALID_PTR, );
-		s = *((pool_u*)ptr - 1);
-		for (i = 0; i < s; i++)
-			set_2_bits(p->slabs, i + page, EMPTY);
+		end = pool_bitmap_next_clear(p->empty, p->page_n, i);
+		if (end - i > stats->longest_run)
+			stats->longest_run = end - i;
 	}
+	POOL_LOCK_RELEASE(&p->lock);
+	stats->largest = (pool_size)stats->longest_run << p->page_shift;
+	if (stats->largest < stats->largest_block)
+		stats->largest = stats->largest_block;
+	stats->index = stats->free == 0 ? 0 : (pool_u)(1000 - (pool_u64)stats->largest * 1000 / stats->free);
 }
 
 /**
-	@fn void pool_slab_stat(pool_slab* p, pool_slab_stats* stats, pool_err* err)
-	@brief Stats the slab pool
+	@fn pool_u8 pool_slab_page_max_order(pool_slab* p, pool_u page, pool_err* err)
+	@brief Gets the order of the largest block that can be allocated in a page
 
 	@param[in] p The slab struct
-	@param[out] stats The stats
+	@param[in] page The page
+	@param[out] err The error that happened
+
+	@return The order of the largest free block, POOL_BUDDY_ORDER_NONE if the page is full or RAW
+*/
+POOL_FUNC pool_u8 pool_slab_page_max_order(pool_slab* p, pool_u page, pool_err* err)
+{
+	pool_u8 order;
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(p == NULL, err, POOL_ERR_INVALID_POOL, POOL_BUDDY_ORDER_NONE);
+	POOL_SET_ERR_IF(page >= p->page_n, err, POOL_ERR_INVALID_PTR, POOL_BUDDY_ORDER_NONE);
+	// The buddy of a RAW page is left free
+	if (get_2_bits(p->slabs, page) == RAW)
+		return POOL_BUDDY_ORDER_NONE;
+	POOL_LOCK_ACQUIRE(&p->buddies[page].lock);
+	order = pool_buddy_max_order(p->buddies + page, err);
+	POOL_LOCK_RELEASE(&p->buddies[page].lock);
+	return order;
+}
+
+/**
+	@fn void pool_slab_free_blocks(pool_slab* p, pool_u* counts, pool_err* err)
+	@brief Counts the free buddy blocks of each order in the whole pool
+
+	An empty page counts as a block of the page order. Walks the buddy tree of every partial page,
+	slower than pool_slab_frag.
+
+	@param[in] p The slab struct
+	@param[out] counts The counts indexed by order (POOL_BUDDY_ORDER_MAX)
 	@param[out] err The error that happened
 */
-POOL_FUNC void pool_slab_stat(pool_slab* p, pool_slab_stats* stats, pool_err* err)
+POOL_FUNC void pool_slab_free_blocks(pool_slab* p, pool_u* counts, pool_err* err)
 {
 	pool_u i;
-	pool_u s;
+	pool_slab_page_type type;
 	POOL_SET_ERR(err, POOL_ERR_OK);
-	stats->size = POOL_SLAB_PAGE_SIZE*POOL_SLAB_PAGE_N;
-	stats->n_pages = POOL_SLAB_PAGE_N;
-	stats->n_pages_empty = 0;
-	stats->n_pages_full = 0;
-	stats->n_pages_partial = 0;
-	stats->n_pages_raw = 0;
-	stats->used = 0;
-	for (i = 0; i < POOL_SLAB_PAGE_N; i++)
-	{
-		pool_slab_page_type type = get_2_bits(p->slabs, i);
-		switch (type)
+	POOL_SET_ERR_IF(p == NULL, err, POOL_ERR_INVALID_POOL, );
+	POOL_SET_ERR_IF(counts == NULL, err, POOL_ERR_INVALID_PTR, );
+	for (i = 0; i < POOL_BUDDY_ORDER_MAX; i++)
+		counts[i] = 0;
+	for (i = 0; i < p->page_n; i++)
+	{
+		type = get_2_bits(p->slabs, i);
+		if (type == EMPTY)
+			counts[p->buddies[i].depth]++;
+		else if (type == PARTIAL)
 		{
-		case EMPTY:
-			stats->n_pages_empty++;
-			break;
-		case PARTIAL:
-			stats->n_pages_partial++;
-			s = pool_buddy_size(p->buddies + i, err);
-			POOL_SET_ERR_IF(err ? *err : 0, err, *err, );
-			stats->used += s;
-			break;
-		case FULL:
-			stats->n_pages_full++;
-			stats->used += POOL_SLAB_PAGE_SIZE;
-			break;
-		case RAW:
-			stats->n_pages_raw++;
-			stats->used += POOL_SLAB_PAGE_SIZE;
-			break;
+			POOL_LOCK_ACQUIRE(&p->buddies[i].lock);
+			pool_buddy_free_blocks(p->buddies + i, counts, NULL);
+			POOL_LOCK_RELEASE(&p->buddies[i].lock);
+		}
+	}
+}
+
+/**
+	@fn void pool_slab_verify(pool_slab* p, pool_err* err)
+	@brief Recounts the pages, used bytes, order lists and free runs and compares them with the counters, checks the free runs
+
+	Walks every page, not to be called while other threads use the pool.
+	Also done by pool_slab_stat when POOL_DEBUG is defined.
+
+	@param[in] p The slab struct
+	@param[out] err POOL_ERR_INVALID_POOL if the counters are wrong
+*/
+POOL_FUNC void pool_slab_verify(pool_slab* p, pool_err* err)
+{
+	pool_u i, j;
+	pool_u count[4] = { 0, 0, 0, 0 };
+	pool_u raw = 0;
+	pool_u run_pages = 0;
+	pool_u order_count[POOL_BUDDY_ORDER_MAX] = { 0 };
+	pool_u run_count[POOL_SLAB_RUN_ORDER_MAX] = { 0 };
+	pool_size used = 0;
+	pool_slab_page_type type;
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(p == NULL, err, POOL_ERR_INVALID_POOL, );
+	for (i = 0; i < p->page_n; i++)
+	{
+		type = get_2_bits(p->slabs, i);
+		count[type]++;
+		// A RAW run is a first page with its length then the rest of the run
+		if (p->raw_n[i] != 0)
+		{
+			POOL_SET_ERR_IF(raw != 0 || type != RAW, err, POOL_ERR_INVALID_POOL, );
+			raw = p->raw_n[i];
+		}
+		POOL_SET_ERR_IF((type == RAW) != (raw != 0), err, POOL_ERR_INVALID_POOL, );
+		if (raw != 0)
+			raw--;
+		// A free run is aligned on its size and only holds empty pages
+		if (p->run_order[i] != POOL_BUDDY_ORDER_NONE)
+		{
+			POOL_SET_ERR_IF(p->run_order[i] >= POOL_SLAB_RUN_ORDER_MAX, err, POOL_ERR_INVALID_POOL, );
+			j = (pool_u)1 << p->run_order[i];
+			POOL_SET_ERR_IF((i & (j - 1)) != 0 || j > p->page_n - i || pool_bitmap_next_clear(p->empty, i + j, i) != i + j, err, POOL_ERR_INVALID_POOL, );
+			run_pages += j;
+			run_count[p->run_order[i]]++;
 		}
+		if (p->order[i] != POOL_BUDDY_ORDER_NONE)
+		{
+			POOL_SET_ERR_IF(p->order[i] >= POOL_BUDDY_ORDER_MAX || type != PARTIAL, err, POOL_ERR_INVALID_POOL, );
+			order_count[p->order[i]]++;
+		}
+		if (type == PARTIAL)
+			used += pool_buddy_size(p->buddies + i, NULL);
+		else if (type != EMPTY)
+			used += p->page_size;
 	}
+	for (i = 0; i < 4; i++)
+		POOL_SET_ERR_IF(count[i] != p->page_count[i], err, POOL_ERR_INVALID_POOL, );
+	POOL_SET_ERR_IF(run_pages != count[EMPTY], err, POOL_ERR_INVALID_POOL, );
+	for (i = 0; i < POOL_BUDDY_ORDER_MAX; i++)
+		POOL_SET_ERR_IF(order_count[i] != p->order_count[i], err, POOL_ERR_INVALID_POOL, );
+	for (i = 0; i < POOL_SLAB_RUN_ORDER_MAX; i++)
+		POOL_SET_ERR_IF(run_count[i] != p->run_count[i], err, POOL_ERR_INVALID_POOL, );
+	POOL_SET_ERR_IF(used != p->used, err, POOL_ERR_INVALID_POOL, );
+	// The decommitted pages are empty pages
+	j = 0;
+	for (i = pool_bitmap_next_set(p->decommitted, p->page_n, 0); i < p->page_n; i = pool_bitmap_next_set(p->decommitted, p->page_n, i + 1), j++)
+		POOL_SET_ERR_IF(!POOL_BITMAP_GET(p->empty, i), err, POOL_ERR_INVALID_POOL, );
+	POOL_SET_ERR_IF(j != p->decommitted_n, err, POOL_ERR_INVALID_POOL, );
 }
 
 /**
@@ -261,26 +1791,7 @@ POOL_FUNC void pool_slab_stat(pool_slab* p, pool_slab_stats* stats, pool_err* er
 */
 POOL_FUNC pool_u pool_slab_size(pool_slab* p, pool_err* err)
 {
-	pool_u i;
-	pool_u s = 0;
-	for (i = 0; i < POOL_SLAB_PAGE_N; i++)
-	{
-		pool_slab_page_type type = get_2_bits(p->slabs, i);
-		switch (type)
-		{
-		case EMPTY:
-			break;
-		case PARTIAL:
-			s += pool_buddy_size(p->buddies + i, err);
-			POOL_SET_ERR_IF(err, err, *err, 0);
-			break;
-		case FULL:
-			s += POOL_SLAB_PAGE_SIZE;
-			break;
-		case RAW:
-			s += POOL_SLAB_PAGE_SIZE;
-			break;
-		}
-	}
-	return s;
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(p == NULL, err, POOL_ERR_INVALID_POOL, 0);
+	return p->used;
 }
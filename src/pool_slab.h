@@ -3,34 +3,60 @@
 #define POOL_SLAB_H_INCLUDED
 
 #include "pool_buddy.h"
+#include "pool_bitmap.h"
+#include "pool_trace.h"
 
 /**
 @defgroup SLAB Slab memory pool
+When POOL_CONCURRENT is defined, a slab pool can be used by several threads at once:
+the page types are updated with compare and swap and every page has its own lock
 @{
 */
 
-/** Size of the slab mem */
+/** Default size of the slab mem */
 #define POOL_SLAB_MAX_SIZE POOL_MAX_SIZE
-/** Size of a slab page */
+/** Default size of a slab page */
 #define POOL_SLAB_PAGE_SIZE POOL_PAGE_SIZE
-/** Number of pages in mem */
-#define POOL_SLAB_PAGE_N (POOL_CEIL_DIV(POOL_SLAB_MAX_SIZE, POOL_SLAB_PAGE_SIZE))
-/** Size of the slab array */
-#define POOL_SLAB_SLAB_SIZE (POOL_CEIL_DIV(POOL_SLAB_PAGE_N, 4))
+/** Default number of pages in mem */
+#define POOL_SLAB_PAGE_N (POOL_SLAB_MAX_SIZE / POOL_SLAB_PAGE_SIZE)
+/**
+	Size of the metadata of a slab pool of n pages: for each page a buddy header, its list links, its RAW run length,
+	the reclaim pass it became empty at, its order, its run order, its type (2 bits), its empty and decommitted bits and its buddy metadata
+*/
+#define POOL_SLAB_META_SIZE_N(n, page_size, block_size) \
+	((n) * (sizeof(pool_buddy) + 4 * sizeof(pool_u) + 2 + POOL_BUDDY_META_SIZE(page_size, block_size)) + \
+	2 * POOL_BITMAP_SIZE(n) * sizeof(pool_u) + POOL_CEIL_DIV(n, 4))
+/** Size of the metadata of a slab pool */
+#define POOL_SLAB_META_SIZE(size, page_size, block_size) POOL_SLAB_META_SIZE_N((size) / (page_size), page_size, block_size)
+/** Size of the memory pool_slab_create needs for n pages */
+#define POOL_SLAB_CREATE_SIZE(n, page_size, block_size) \
+	(POOL_ALIGN_UP(sizeof(pool_slab) + POOL_SLAB_META_SIZE_N(n, page_size, block_size), page_size) + (n) * (page_size))
+
+/** Number of free run orders (a run of order n is 2^n empty pages starting on a multiple of 2^n) */
+#define POOL_SLAB_RUN_ORDER_MAX (sizeof(pool_u) * 8)
+
+/** Marks the header of a pool made by pool_slab_create ("MSLB" in little endian) */
+#define POOL_SLAB_MAGIC 0x424c534d
+/** Identifies the struct layout of the build, a pool made by another build (or with POOL_CONCURRENT toggled) is rejected */
+#define POOL_SLAB_LAYOUT ((pool_u32)(sizeof(pool_slab) * 256 + sizeof(pool_buddy)))
+/** No root buffer */
+#define POOL_SLAB_NO_ROOT ((pool_u)-1)
+/** Offset of a buffer from the pages of a pool, stays valid when the pool is mapped at another address */
+#define POOL_SLAB_OFFSET(p, ptr) ((pool_u)((char*)(ptr) - (char*)(p)->mem))
+/** Buffer at an offset from the pages of a pool */
+#define POOL_SLAB_PTR(p, offset) ((void*)((char*)(p)->mem + (offset)))
 
 /**
-	@struct _pool_slab
-	@brief The slab pool header
+	Gives the physical memory of size bytes of pages back to the system, their content may be lost.
+	Returns the alignment (power of 2) of the pieces given back, every whole aligned piece inside the range was
+	given back and the rest stays resident, 0 if nothing was given back.
 */
-typedef struct _pool_slab
-{
-	/** The slab array */
-	pool_u8 slabs[POOL_SLAB_SLAB_SIZE];
-	/** The array of buddy pool (1 per page) */
-	pool_buddy buddies[POOL_SLAB_PAGE_N];
-	/** Base of memory */
-	void* mem;
-} pool_slab;
+typedef pool_size (*pool_decommit)(void* data, void* mem, pool_size size);
+
+/** Placement of RAW allocations no free run can hold (POOL_BITMAP_FIRST_FIT or POOL_BITMAP_BEST_FIT) */
+#ifndef POOL_SLAB_RAW_FIT
+#define POOL_SLAB_RAW_FIT POOL_BITMAP_FIRST_FIT
+#endif
 
 /**
 	@struct _pool_slab_stats
@@ -38,8 +64,10 @@ typedef struct _pool_slab
 */
 typedef struct _pool_slab_stats
 {
-	/** Size of the pool */
+	/** Size of the pool (reserved bytes) */
 	pool_size size;
+	/** Bytes of the pages that were not decommitted (the most the pool keeps resident) */
+	pool_size resident;
 	/** Used bytes in the pool */
 	pool_size used;
 	/** Number of pages in the pool */
@@ -52,8 +80,124 @@ typedef struct _pool_slab_stats
 	pool_u n_pages_full;
 	/** Number of raw pages in the pool */
 	pool_u n_pages_raw;
+	/** Number of empty pages given back to the system by pool_slab_reclaim and not used since */
+	pool_u n_pages_decommitted;
 } pool_slab_stats;
 
+/**
+	@struct _pool_slab_frag_stats
+	@brief Fragmentation of the slab pool, read from counters kept by the allocations
+*/
+typedef struct _pool_slab_frag_stats
+{
+	/** Free bytes in the pool */
+	pool_size free;
+	/** Size of the largest buffer that can be allocated */
+	pool_size largest;
+	/** Size of the largest buddy block that can be allocated (the page size if a page is empty, 0 if none) */
+	pool_size largest_block;
+	/** Number of pages of the longest run of empty pages (the largest RAW buffer) */
+	pool_u longest_run;
+	/** External fragmentation index in per mille: 1000 * (1 - largest / free), 0 if nothing is free */
+	pool_u index;
+	/** Number of partial pages whose largest free block is of each order */
+	pool_u pages_by_order[POOL_BUDDY_ORDER_MAX];
+	/** Number of free runs of empty pages of each order */
+	pool_u runs_by_order[POOL_SLAB_RUN_ORDER_MAX];
+} pool_slab_frag_stats;
+
+/**
+	@struct _pool_slab
+	@brief The slab pool header
+
+	The per page arrays are in the metadata storage given to pool_slab_init.
+	page_n is used as the invalid page index (end of the order lists).
+	The empty pages are split in free runs, aligned runs of 2^n pages merged with their buddy run
+	when it is free. A page is either in an order list (PARTIAL), the first page of a free run or in neither,
+	so both kinds of lists share the links.
+	The pointers to the arrays and mem are set from the geometry, the lists hold page indexes and the buddies
+	offsets, so pool_slab_attach can take a pool made by pool_slab_create back at another address.
+*/
+typedef struct _pool_slab
+{
+	/** POOL_SLAB_MAGIC if the pool was made by pool_slab_create */
+	pool_u32 magic;
+	/** POOL_SLAB_LAYOUT of the build that made the pool */
+	pool_u32 layout;
+	/** The slab array (2 bits per page) */
+	pool_u8* slabs;
+	/** The array of buddy pool (1 per page) */
+	pool_buddy* buddies;
+	/** First page of each order list (pages whose largest free block is of that order) */
+	pool_u order_head[POOL_BUDDY_ORDER_MAX];
+	/** Next page in the order list or the run list */
+	pool_u* order_next;
+	/** Previous page in the order list or the run list */
+	pool_u* order_prev;
+	/** The order list each page is in (POOL_BUDDY_ORDER_NONE if none) */
+	pool_u8* order;
+	/** Bit n is set if the order n list is not empty */
+	pool_u order_mask;
+	/** Number of pages in each order list */
+	pool_u order_count[POOL_BUDDY_ORDER_MAX];
+	/** First page of each free run list */
+	pool_u run_head[POOL_SLAB_RUN_ORDER_MAX];
+	/** Bit n is set if the run list n is not empty */
+	pool_u run_mask;
+	/** Number of free runs in each run list */
+	pool_u run_count[POOL_SLAB_RUN_ORDER_MAX];
+	/** The order of the free run starting at each page (POOL_BUDDY_ORDER_NONE if none) */
+	pool_u8* run_order;
+	/** Number of pages of the RAW buffer starting at each page (0 if none) */
+	pool_u* raw_n;
+	/** Bitmap of the empty pages */
+	pool_u* empty;
+	/** Bitmap of the empty pages given back to the system (a subset of empty) */
+	pool_u* decommitted;
+	/** Number of decommitted pages */
+	pool_u decommitted_n;
+	/** The reclaim pass each page became empty at */
+	pool_u* empty_since;
+	/** Number of pool_slab_reclaim passes */
+	pool_u epoch;
+	/** Number of pages */
+	pool_u page_n;
+	/** Size of a page */
+	pool_size page_size;
+	/** Log 2 of the page size */
+	pool_u8 page_shift;
+	/** Log 2 of the block size */
+	pool_u8 block_shift;
+	/** 1 from pool_slab_create or pool_slab_attach to pool_slab_detach */
+	pool_u8 attached;
+	/** Size of the memory given to pool_slab_create (0 if made by pool_slab_init) */
+	pool_size region_size;
+	/** Offset of the root buffer from mem (POOL_SLAB_NO_ROOT if none) */
+	pool_u root;
+	/** Number of pages of each type (indexed by pool_slab_page_type) */
+	pool_u page_count[4];
+	/** Used bytes (a FULL or RAW page counts as a whole page) */
+	pool_size used;
+#ifdef POOL_CONCURRENT
+	/** Guards the order lists and the empty pages bitmap (each page is guarded by the lock of its buddy) */
+	pool_lock lock;
+#endif
+	/** Base of memory */
+	void* mem;
+} pool_slab;
+
+/**
+	@struct _pool_slab_static
+	@brief A slab pool with the default geometry and its metadata
+*/
+typedef struct _pool_slab_static
+{
+	/** The slab pool */
+	pool_slab slab;
+	/** The metadata storage */
+	void* meta[POOL_CEIL_DIV(POOL_SLAB_META_SIZE(POOL_SLAB_MAX_SIZE, POOL_SLAB_PAGE_SIZE, POOL_BUDDY_BLOCK_SIZE), sizeof(void*))];
+} pool_slab_static;
+
 /**
 	@enum _pool_slab_page_type
 	@brief The types of pages
@@ -66,30 +210,130 @@ typedef enum _pool_slab_page_type
 	PARTIAL = 1,
 	/** Page is fully allocated*/
 	FULL = 2,
-	/** Allocation for buffer with its size greater than the page size */
+	/** Allocation for buffer with its size greater than the page size (the pointer is the page) */
 	RAW = 3
 } pool_slab_page_type;
 
 /**
-	@fn void pool_slab_init(pool_slab* p, void* mem, pool_err* err)
+	@fn void pool_slab_init(pool_slab* p, void* mem, pool_size size, pool_size page_size, pool_size block_size, void* meta, pool_err* err)
 	@brief Initializes the slab pool
 
+	page_size and block_size must be powers of 2, size is rounded down to a multiple of page_size.
+
 	@param[inout] p The slab struct
 	@param[in] mem The memory base
+	@param[in] size The size of the memory
+	@param[in] page_size The size of a page
+	@param[in] block_size The size of a block in a page
+	@param[in] meta The metadata storage (POOL_SLAB_META_SIZE(size, page_size, block_size) bytes, pointer aligned)
 	@param[out] err The error that happened
 */
-POOL_FUNC void pool_slab_init(pool_slab* p, void* mem, pool_err* err);
+POOL_FUNC void pool_slab_init(pool_slab* p, void* mem, pool_size size, pool_size page_size, pool_size block_size, void* meta, pool_err* err);
+
+/**
+	@fn pool_slab* pool_slab_create(void* mem, pool_size size, pool_size page_size, pool_size block_size, pool_err* err)
+	@brief Creates a slab pool with its header and metadata at the start of the memory
+
+	The pages start at the first multiple of page_size (from mem) after the metadata.
+
+	@param[in] mem The memory base (pointer aligned)
+	@param[in] size The size of the memory
+	@param[in] page_size The size of a page
+	@param[in] block_size The size of a block in a page
+	@param[out] err The error that happened
+
+	@return The slab pool, NULL if mem is too small
+*/
+POOL_FUNC pool_slab* pool_slab_create(void* mem, pool_size size, pool_size page_size, pool_size block_size, pool_err* err);
+
+/**
+	@fn pool_slab* pool_slab_attach(void* mem, pool_size size, pool_err* err)
+	@brief Takes back a pool made by pool_slab_create, the memory may be mapped at another address
+
+	Checks the header (magic, build layout, size, geometry, counters) and sets the pointers from the geometry,
+	the pages are not visited. A pool that was not detached (its process stopped while using it) gets its locks
+	released and is checked with pool_slab_verify.
+
+	@param[in] mem The memory base, the same bytes as the one given to pool_slab_create
+	@param[in] size The size of the memory, the size given to pool_slab_create
+	@param[out] err The error that happened (POOL_ERR_INVALID_POOL if the memory does not hold a valid pool)
+
+	@return The slab pool, NULL on failure
+*/
+POOL_FUNC pool_slab* pool_slab_attach(void* mem, pool_size size, pool_err* err);
+
+/**
+	@fn void pool_slab_detach(pool_slab* p, pool_err* err)
+	@brief Marks a pool made by pool_slab_create as closed, pool_slab_attach will not check its pages
+
+	No thread may use the pool after.
+
+	@param[inout] p The slab struct
+	@param[out] err The error that happened
+*/
+POOL_FUNC void pool_slab_detach(pool_slab* p, pool_err* err);
+
+/**
+	@fn void pool_slab_set_root(pool_slab* p, void* ptr, pool_err* err)
+	@brief Records a buffer to find the data of the pool after pool_slab_attach
+
+	@param[inout] p The slab struct
+	@param[in] ptr The buffer (NULL for none)
+	@param[out] err The error that happened
+*/
+POOL_FUNC void pool_slab_set_root(pool_slab* p, void* ptr, pool_err* err);
+
+/**
+	@fn void* pool_slab_root(pool_slab* p, pool_err* err)
+	@brief Gets the buffer recorded by pool_slab_set_root, at the current address of the pool
+
+	@param[in] p The slab struct
+	@param[out] err The error that happened
+
+	@return The buffer, NULL if none
+*/
+POOL_FUNC void* pool_slab_root(pool_slab* p, pool_err* err);
+
+/**
+	@fn void pool_slab_static_init(pool_slab_static* p, void* mem, pool_err* err)
+	@brief Initializes a slab pool with the default geometry
+
+	@param[inout] p The slab struct
+	@param[in] mem The memory base (POOL_SLAB_MAX_SIZE bytes)
+	@param[out] err The error that happened
+*/
+POOL_FUNC void pool_slab_static_init(pool_slab_static* p, void* mem, pool_err* err);
 
 /**
 	@fn void* pool_slab_malloc(pool_slab* p, pool_size size, pool_err* err)
 	@brief Allocates size bytes in the memory
 
+	A RAW buffer takes the smallest free run that can hold it and gives back the rest of the run,
+	a buffer with no free run large enough takes the first (POOL_SLAB_RAW_FIT) empty pages.
+	A buddy buffer takes a partial page, then the first page of the smallest free run.
+
 	@param[in] p The slab struct
 	@param[in] size The number of bytes to allocate
 	@param[out] err The error that happened
 */
 POOL_FUNC void* pool_slab_malloc(pool_slab* p, pool_size size, pool_err* err);
 
+/**
+	@fn void* pool_slab_memalign(pool_slab* p, pool_size align, pool_size size, pool_err* err)
+	@brief Allocates size bytes aligned on align bytes
+
+	A buddy block is aligned on its size in its page, a larger alignment takes a RAW buffer
+	starting on an aligned page. The memory base must be aligned on min(align, page size).
+
+	@param[in] p The slab struct
+	@param[in] align The alignment (power of 2)
+	@param[in] size The number of bytes to allocate
+	@param[out] err The error that happened
+
+	@return The allocated buffer
+*/
+POOL_FUNC void* pool_slab_memalign(pool_slab* p, pool_size align, pool_size size, pool_err* err);
+
 /**
 	@fn void pool_slab_free(pool_slab* p, void* ptr, pool_err* err)
 	@brief Frees a previously allocated buffer
@@ -97,11 +341,80 @@ POOL_FUNC void* pool_slab_malloc(pool_slab* p, pool_size size, pool_err* err);
 	@param[in] p The slab struct
 	@param[in] ptr The buffer to free
 	@param[out] err The error that happened
-
-	@return The allocated buffer
 */
 POOL_FUNC void pool_slab_free(pool_slab* p, void* ptr, pool_err* err);
 
+/**
+	@fn void pool_slab_free_sized(pool_slab* p, void* ptr, pool_size size, pool_err* err)
+	@brief Frees a buffer of a known size, skips the search of its block
+
+	ptr and size are only checked when POOL_DEBUG is defined.
+
+	@param[in] p The slab struct
+	@param[in] ptr The buffer to free
+	@param[in] size The size given to malloc, realloc or memalign (for memalign on at most a page, the alignment if it is larger)
+	@param[out] err The error that happened
+*/
+POOL_FUNC void pool_slab_free_sized(pool_slab* p, void* ptr, pool_size size, pool_err* err);
+
+/**
+	@fn pool_u pool_slab_malloc_batch(pool_slab* p, pool_size size, pool_u n, void** out, pool_err* err)
+	@brief Allocates n buffers of size bytes, each page is filled before moving to the next one
+
+	@param[inout] p The slab struct
+	@param[in] size The size of a buffer
+	@param[in] n The number of buffers
+	@param[out] out The allocated buffers
+	@param[out] err The error that happened (POOL_ERR_OUT_OF_MEM if less than n buffers were allocated)
+
+	@return The number of allocated buffers, they are at the start of out
+*/
+POOL_FUNC pool_u pool_slab_malloc_batch(pool_slab* p, pool_size size, pool_u n, void** out, pool_err* err);
+
+/**
+	@fn void pool_slab_free_batch(pool_slab* p, void** ptrs, pool_u n, pool_err* err)
+	@brief Frees n buffers, the buffers of a page are freed together
+
+	The buffers are sorted by address first, so each page is locked once.
+
+	@param[inout] p The slab struct
+	@param[inout] ptrs The buffers (NULL entries are skipped), sorted by address on return
+	@param[in] n The number of buffers
+	@param[out] err The error that happened (the other buffers are still freed)
+*/
+POOL_FUNC void pool_slab_free_batch(pool_slab* p, void** ptrs, pool_u n, pool_err* err);
+
+/**
+	@fn void* pool_slab_realloc(pool_slab* p, void* ptr, pool_size size, pool_err* err)
+	@brief Resizes a buffer, in place when possible
+
+	A buddy buffer grows into its free buddies and shrinks by splitting, a RAW buffer grows
+	into the next empty pages and gives back its last pages. Otherwise the buffer is moved.
+
+	@param[inout] p The slab struct
+	@param[in] ptr The buffer (NULL to allocate)
+	@param[in] size The new size (0 to free)
+	@param[out] err The error that happened
+
+	@return The resized buffer, NULL on failure (ptr is still valid)
+*/
+POOL_FUNC void* pool_slab_realloc(pool_slab* p, void* ptr, pool_size size, pool_err* err);
+
+/**
+	@fn pool_u8 pool_slab_block_order(pool_slab* p, void* ptr, pool_err* err)
+	@brief Finds the buddy order of an allocated buffer
+
+	Reads the page type and the buddy tree of the page, which the other buffers of the page change: with POOL_CONCURRENT
+	the page lock is taken, otherwise the call must be serialized with the other operations on the pool.
+
+	@param[in] p The slab struct
+	@param[in] ptr The allocated buffer
+	@param[out] err The error that happened
+
+	@return The order of the buffer, POOL_BUDDY_ORDER_NONE for a RAW buffer
+*/
+POOL_FUNC pool_u8 pool_slab_block_order(pool_slab* p, void* ptr, pool_err* err);
+
 /**
 	@fn void pool_slab_stat(pool_slab* p, pool_slab_stats* stats, pool_err* err)
 	@brief Stats the slab pool
@@ -112,6 +425,77 @@ POOL_FUNC void pool_slab_free(pool_slab* p, void* ptr, pool_err* err);
 */
 POOL_FUNC void pool_slab_stat(pool_slab* p, pool_slab_stats* stats, pool_err* err);
 
+/**
+	@fn pool_u pool_slab_reclaim(pool_slab* p, pool_u delay, pool_u keep, pool_decommit decommit, void* data, pool_err* err)
+	@brief Gives back to the system the empty pages that stayed empty for delay passes
+
+	To be called periodically, each call is a pass. A page is decommitted once it stayed empty for delay whole passes,
+	the first keep resident empty pages (in address order) are always kept, so the pages that are freed and reused
+	between two passes stay resident. A decommitted page is used again as is, the system gives it back on first touch.
+	Walks the empty pages bitmap and calls decommit with the index lock held. Only the pages inside the pieces
+	decommit reports are counted as decommitted, the others are given to decommit again by the next passes.
+
+	@param[inout] p The slab struct
+	@param[in] delay The number of whole passes a page must stay empty (0 for every page that was empty before the call)
+	@param[in] keep The number of resident empty pages never decommitted
+	@param[in] decommit Gives the pages back (pool_os_decommit for memory from mmap or VirtualAlloc)
+	@param[in] data The data passed to decommit
+	@param[out] err The error that happened
+
+	@return The number of pages decommitted by this pass
+*/
+POOL_FUNC pool_u pool_slab_reclaim(pool_slab* p, pool_u delay, pool_u keep, pool_decommit decommit, void* data, pool_err* err);
+
+/**
+	@fn void pool_slab_frag(pool_slab* p, pool_slab_frag_stats* stats, pool_err* err)
+	@brief Reports the fragmentation of the slab pool
+
+	Copies the order list and free run counters and scans the empty pages bitmap for the longest run,
+	no page is visited, so it can be called often.
+
+	@param[in] p The slab struct
+	@param[out] stats The fragmentation report
+	@param[out] err The error that happened
+*/
+POOL_FUNC void pool_slab_frag(pool_slab* p, pool_slab_frag_stats* stats, pool_err* err);
+
+/**
+	@fn pool_u8 pool_slab_page_max_order(pool_slab* p, pool_u page, pool_err* err)
+	@brief Gets the order of the largest block that can be allocated in a page
+
+	@param[in] p The slab struct
+	@param[in] page The page
+	@param[out] err The error that happened
+
+	@return The order of the largest free block, POOL_BUDDY_ORDER_NONE if the page is full or RAW
+*/
+POOL_FUNC pool_u8 pool_slab_page_max_order(pool_slab* p, pool_u page, pool_err* err);
+
+/**
+	@fn void pool_slab_free_blocks(pool_slab* p, pool_u* counts, pool_err* err)
+	@brief Counts the free buddy blocks of each order in the whole pool
+
+	An empty page counts as a block of the page order. Walks the buddy tree of every partial page,
+	slower than pool_slab_frag.
+
+	@param[in] p The slab struct
+	@param[out] counts The counts indexed by order (POOL_BUDDY_ORDER_MAX)
+	@param[out] err The error that happened
+*/
+POOL_FUNC void pool_slab_free_blocks(pool_slab* p, pool_u* counts, pool_err* err);
+
+/**
+	@fn void pool_slab_verify(pool_slab* p, pool_err* err)
+	@brief Recounts the pages, used bytes, order lists and free runs and compares them with the counters, checks the free runs
+
+	Walks every page, not to be called while other threads use the pool.
+	Also done by pool_slab_stat when POOL_DEBUG is defined.
+
+	@param[in] p The slab struct
+	@param[out] err POOL_ERR_INVALID_POOL if the counters are wrong
+*/
+POOL_FUNC void pool_slab_verify(pool_slab* p, pool_err* err);
+
 /**
 	@fn pool_u pool_slab_size(pool_slab* p, pool_err* err)
 	@brief Calculates the number of allocated bytes
@@ -0,0 +1,295 @@
+#include "pool_tcache.h"
+
+/**
+	@fn static void tcache_lock(pool_tcache* tc)
+	@brief Locks the shared pool
+
+	@param[in] tc The thread cache
+*/
+POOL_FUNC static void tcache_lock(pool_tcache* tc)
+{
+	if (tc->lock != NULL)
+		tc->lock(tc->lock_data);
+}
+
+/**
+	@fn static void tcache_unlock(pool_tcache* tc)
+	@brief Unlocks the shared pool
+
+	@param[in] tc The thread cache
+*/
+POOL_FUNC static void tcache_unlock(pool_tcache* tc)
+{
+	if (tc->unlock != NULL)
+		tc->unlock(tc->lock_data);
+}
+
+/**
+	@fn static void refill(pool_tcache* tc, pool_u8 order, pool_err* err)
+	@brief Takes a batch of blocks of an order from the shared pool
+
+	@param[inout] tc The thread cache
+	@param[in] order The order of the blocks
+	@param[out] err The error that happened if no block could be taken
+*/
+POOL_FUNC static void refill(pool_tcache* tc, pool_u8 order, pool_err* err)
+{
+	tcache_lock(tc);
+	tc->count[order] += pool_slab_malloc_batch(tc->pool, (pool_size)1 << (tc->pool->buddies->block_shift + order), POOL_TCACHE_BATCH, tc->blocks[order] + tc->count[order], err);
+	tcache_unlock(tc);
+	tc->stats.refills++;
+	if (tc->count[order] != 0)
+		POOL_SET_ERR(err, POOL_ERR_OK);
+}
+
+/**
+	@fn static void drain(pool_tcache* tc, pool_u8 order, pool_u n, pool_err* err)
+	@brief Gives the n oldest blocks of an order back to the shared pool
+
+	@param[inout] tc The thread cache
+	@param[in] order The order of the blocks
+	@param[in] n The number of blocks
+	@param[out] err The error that happened
+*/
+POOL_FUNC static void drain(pool_tcache* tc, pool_u8 order, pool_u n, pool_err* err)
+{
+	pool_u i;
+	tcache_lock(tc);
+	pool_slab_free_batch(tc->pool, tc->blocks[order], n, err);
+	tcache_unlock(tc);
+	for (i = n; i < tc->count[order]; i++)
+		tc->blocks[order][i - n] = tc->blocks[order][i];
+	tc->count[order] -= n;
+	tc->stats.drains++;
+}
+
+/**
+	@fn void pool_tcache_init(pool_tcache* tc, pool_slab* pool, pool_tcache_lock_func lock, pool_tcache_lock_func unlock, void* lock_data, pool_err* err)
+	@brief Initializes a thread cache
+
+	@param[out] tc The thread cache
+	@param[in] pool The shared pool
+	@param[in] lock Locks the shared pool (NULL if not needed, e.g. with POOL_CONCURRENT)
+	@param[in] unlock Unlocks the shared pool (NULL if not needed)
+	@param[in] lock_data The data passed to lock and unlock
+	@param[out] err The error that happened
+*/
+POOL_FUNC void pool_tcache_init(pool_tcache* tc, pool_slab* pool, pool_tcache_lock_func lock, pool_tcache_lock_func unlock, void* lock_data, pool_err* err)
+{
+	pool_u i;
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(tc == NULL, err, POOL_ERR_INVALID_POOL, );
+	POOL_SET_ERR_IF(pool == NULL, err, POOL_ERR_INVALID_POOL, );
+	tc->pool = pool;
+	tc->lock = lock;
+	tc->unlock = unlock;
+	tc->lock_data = lock_data;
+	for (i = 0; i < POOL_TCACHE_ORDER_N; i++)
+		tc->count[i] = 0;
+	tc->stats.malloc_hits = 0;
+	tc->stats.malloc_misses = 0;
+	tc->stats.free_hits = 0;
+	tc->stats.free_misses = 0;
+	tc->stats.refills = 0;
+	tc->stats.drains = 0;
+	tc->stats.cached = 0;
+}
+
+/**
+	@fn void* pool_tcache_malloc(pool_tcache* tc, pool_size size, pool_err* err)
+	@brief Allocates size bytes, from the cache if possible
+
+	@param[inout] tc The thread cache
+	@param[in] size The number of bytes to allocate
+	@param[out] err The error that happened
+
+	@return The allocated buffer
+*/
+POOL_FUNC void* pool_tcache_malloc(pool_tcache* tc, pool_size size, pool_err* err)
+{
+	pool_u8 order;
+	void* ret;
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(tc == NULL, err, POOL_ERR_INVALID_POOL, NULL);
+	POOL_SET_ERR_IF(size == 0, err, POOL_ERR_INVALID_SIZE, NULL);
+	order = size > tc->pool->page_size ? POOL_BUDDY_ORDER_NONE : pool_buddy_order(tc->pool->buddies, size);
+	// RAW buffers and blocks above the cached orders are not cached
+	if (order >= POOL_TCACHE_ORDER_N)
+	{
+		tc->stats.malloc_misses++;
+		tcache_lock(tc);
+		ret = pool_slab_malloc(tc->pool, size, err);
+		tcache_unlock(tc);
+		return ret;
+	}
+	if (tc->count[order] == 0)
+	{
+		tc->stats.malloc_misses++;
+		refill(tc, order, err);
+		if (tc->count[order] == 0)
+			return NULL;
+	}
+	else
+		tc->stats.malloc_hits++;
+	return tc->blocks[order][--tc->count[order]];
+}
+
+/**
+	@fn static void cache_block(pool_tcache* tc, pool_u8 order, void* ptr, pool_err* err)
+	@brief Puts a block in the cache, drains the oldest blocks of its order first if it is full
+
+	@param[inout] tc The thread cache
+	@param[in] order The order of the block (a cached order)
+	@param[in] ptr The block
+	@param[out] err The error that happened
+*/
+POOL_FUNC static void cache_block(pool_tcache* tc, pool_u8 order, void* ptr, pool_err* err)
+{
+	if (tc->count[order] == POOL_TCACHE_SIZE)
+	{
+		tc->stats.free_misses++;
+		drain(tc, order, POOL_TCACHE_BATCH, err);
+	}
+	else
+		tc->stats.free_hits++;
+	tc->blocks[order][tc->count[order]++] = ptr;
+}
+
+/**
+	@fn void pool_tcache_free(pool_tcache* tc, void* ptr, pool_err* err)
+	@brief Frees a buffer of the shared pool, into the cache if possible
+
+	Looks up the order of the buffer under the lock of the shared pool, so every free takes it:
+	pool_tcache_free_sized keeps the cache hits off the shared pool.
+
+	@param[inout] tc The thread cache
+	@param[in] ptr The buffer to free (may come from another thread's cache)
+	@param[out] err The error that happened
+*/
+POOL_FUNC void pool_tcache_free(pool_tcache* tc, void* ptr, pool_err* err)
+{
+	pool_u8 order;
+	pool_err err2;
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	if (ptr == NULL)
+		return;
+	POOL_SET_ERR_IF(tc == NULL, err, POOL_ERR_INVALID_POOL, );
+	// The page types and buddy trees are shared, other threads change them under the lock
+	tcache_lock(tc);
+	order = pool_slab_block_order(tc->pool, ptr, &err2);
+	if (err2 != POOL_ERR_OK)
+	{
+		tcache_unlock(tc);
+		POOL_SET_ERR(err, err2);
+		return;
+	}
+	// RAW buffers and blocks above the cached orders are not cached
+	if (order >= POOL_TCACHE_ORDER_N)
+	{
+		tc->stats.free_misses++;
+		pool_slab_free(tc->pool, ptr, err);
+		tcache_unlock(tc);
+		return;
+	}
+	tcache_unlock(tc);
+	cache_block(tc, order, ptr, err);
+}
+
+/**
+	@fn void pool_tcache_free_sized(pool_tcache* tc, void* ptr, pool_size size, pool_err* err)
+	@brief Frees a buffer of a known size, into the cache if possible
+
+	The order comes from the size, a cache hit touches only the cache. size is only checked
+	against the block when POOL_DEBUG is defined.
+
+	@param[inout] tc The thread cache
+	@param[in] ptr The buffer to free (may come from another thread's cache)
+	@param[in] size The size given to malloc
+	@param[out] err The error that happened
+*/
+POOL_FUNC void pool_tcache_free_sized(pool_tcache* tc, void* ptr, pool_size size, pool_err* err)
+{
+	pool_u8 order;
+#ifdef POOL_DEBUG
+	pool_u8 block_order;
+#endif
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	if (ptr == NULL)
+		return;
+	POOL_SET_ERR_IF(tc == NULL, err, POOL_ERR_INVALID_POOL, );
+	POOL_SET_ERR_IF(size == 0, err, POOL_ERR_INVALID_SIZE, );
+	order = size > tc->pool->page_size ? POOL_BUDDY_ORDER_NONE : pool_buddy_order(tc->pool->buddies, size);
+	// RAW buffers and blocks above the cached orders are not cached
+	if (order >= POOL_TCACHE_ORDER_N)
+	{
+		tc->stats.free_misses++;
+		tcache_lock(tc);
+		pool_slab_free_sized(tc->pool, ptr, size, err);
+		tcache_unlock(tc);
+		return;
+	}
+#ifdef POOL_DEBUG
+	tcache_lock(tc);
+	block_order = pool_slab_block_order(tc->pool, ptr, err);
+	tcache_unlock(tc);
+	POOL_SET_ERR_IF(err ? *err : 0, err, *err, );
+	POOL_SET_ERR_IF(block_order != order, err, POOL_ERR_INVALID_SIZE, );
+#endif
+	cache_block(tc, order, ptr, err);
+}
+
+/**
+	@fn void pool_tcache_flush(pool_tcache* tc, pool_err* err)
+	@brief Gives all the cached blocks back to the shared pool
+
+	@param[inout] tc The thread cache
+	@param[out] err The error that happened
+*/
+POOL_FUNC void pool_tcache_flush(pool_tcache* tc, pool_err* err)
+{
+	pool_u8 i;
+	pool_err err2;
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(tc == NULL, err, POOL_ERR_INVALID_POOL, );
+	for (i = 0; i < POOL_TCACHE_ORDER_N; i++)
+	{
+		if (tc->count[i] == 0)
+			continue;
+		drain(tc, i, tc->count[i], &err2);
+		if (err2 != POOL_ERR_OK)
+			POOL_SET_ERR(err, err2);
+	}
+}
+
+/**
+	@fn void pool_tcache_exit(void* tc)
+	@brief Flushes a thread cache when its thread exits
+
+	Has the signature of a thread-specific storage destructor (pthread_key_create, tss_create, FlsAlloc).
+
+	@param[inout] tc The thread cache
+*/
+POOL_FUNC void pool_tcache_exit(void* tc)
+{
+	pool_tcache_flush((pool_tcache*)tc, NULL);
+}
+
+/**
+	@fn void pool_tcache_stat(pool_tcache* tc, pool_tcache_stats* stats, pool_err* err)
+	@brief Stats the thread cache
+
+	@param[in] tc The thread cache
+	@param[out] stats The statistics
+	@param[out] err The error that happened
+*/
+POOL_FUNC void pool_tcache_stat(pool_tcache* tc, pool_tcache_stats* stats, pool_err* err)
+{
+	pool_u8 i;
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(tc == NULL, err, POOL_ERR_INVALID_POOL, );
+	POOL_SET_ERR_IF(stats == NULL, err, POOL_ERR_INVALID_PTR, );
+	*stats = tc->stats;
+	stats->cached = 0;
+	for (i = 0; i < POOL_TCACHE_ORDER_N; i++)
+		stats->cached += tc->count[i];
+}
@@ -0,0 +1,157 @@
+/** @file */
+#ifndef POOL_TCACHE_H_INCLUDED
+#define POOL_TCACHE_H_INCLUDED
+
+#include "pool_slab.h"
+
+/**
+@defgroup TCACHE Thread cache
+@{
+*/
+
+/** Maximum number of blocks kept per order */
+#ifndef POOL_TCACHE_SIZE
+#define POOL_TCACHE_SIZE 32
+#endif
+
+/** Number of blocks moved at once between the cache and the shared pool */
+#ifndef POOL_TCACHE_BATCH
+#define POOL_TCACHE_BATCH (POOL_TCACHE_SIZE / 2)
+#endif
+
+/** Number of cached orders, blocks of the orders above go to the shared pool */
+#ifndef POOL_TCACHE_ORDER_N
+#define POOL_TCACHE_ORDER_N POOL_BUDDY_ORDER_N
+#endif
+
+/** Lock or unlock callback of the shared pool */
+typedef void (*pool_tcache_lock_func)(void*);
+
+/**
+	@struct _pool_tcache_stats
+	@brief Statistics about a thread cache
+*/
+typedef struct _pool_tcache_stats
+{
+	/** Number of allocations served by the cache */
+	pool_u malloc_hits;
+	/** Number of allocations that needed the shared pool */
+	pool_u malloc_misses;
+	/** Number of frees kept by the cache */
+	pool_u free_hits;
+	/** Number of frees that needed the shared pool */
+	pool_u free_misses;
+	/** Number of batches taken from the shared pool */
+	pool_u refills;
+	/** Number of batches given back to the shared pool */
+	pool_u drains;
+	/** Number of blocks currently in the cache */
+	pool_u cached;
+} pool_tcache_stats;
+
+/**
+	@struct _pool_tcache
+	@brief A per thread cache of blocks in front of a shared slab pool
+*/
+typedef struct _pool_tcache
+{
+	/** The shared pool */
+	pool_slab* pool;
+	/** Locks the shared pool (NULL if not needed) */
+	pool_tcache_lock_func lock;
+	/** Unlocks the shared pool (NULL if not needed) */
+	pool_tcache_lock_func unlock;
+	/** The data passed to lock and unlock */
+	void* lock_data;
+	/** The cached blocks of each order */
+	void* blocks[POOL_TCACHE_ORDER_N][POOL_TCACHE_SIZE];
+	/** The number of cached blocks of each order */
+	pool_u count[POOL_TCACHE_ORDER_N];
+	/** The statistics */
+	pool_tcache_stats stats;
+} pool_tcache;
+
+/**
+	@fn void pool_tcache_init(pool_tcache* tc, pool_slab* pool, pool_tcache_lock_func lock, pool_tcache_lock_func unlock, void* lock_data, pool_err* err)
+	@brief Initializes a thread cache
+
+	@param[out] tc The thread cache
+	@param[in] pool The shared pool
+	@param[in] lock Locks the shared pool (NULL if not needed, e.g. with POOL_CONCURRENT)
+	@param[in] unlock Unlocks the shared pool (NULL if not needed)
+	@param[in] lock_data The data passed to lock and unlock
+	@param[out] err The error that happened
+*/
+POOL_FUNC void pool_tcache_init(pool_tcache* tc, pool_slab* pool, pool_tcache_lock_func lock, pool_tcache_lock_func unlock, void* lock_data, pool_err* err);
+
+/**
+	@fn void* pool_tcache_malloc(pool_tcache* tc, pool_size size, pool_err* err)
+	@brief Allocates size bytes, from the cache if possible
+
+	@param[inout] tc The thread cache
+	@param[in] size The number of bytes to allocate
+	@param[out] err The error that happened
+
+	@return The allocated buffer
+*/
+POOL_FUNC void* pool_tcache_malloc(pool_tcache* tc, pool_size size, pool_err* err);
+
+/**
+	@fn void pool_tcache_free(pool_tcache* tc, void* ptr, pool_err* err)
+	@brief Frees a buffer of the shared pool, into the cache if possible
+
+	Looks up the order of the buffer under the lock of the shared pool, so every free takes it:
+	pool_tcache_free_sized keeps the cache hits off the shared pool.
+
+	@param[inout] tc The thread cache
+	@param[in] ptr The buffer to free (may come from another thread's cache)
+	@param[out] err The error that happened
+*/
+POOL_FUNC void pool_tcache_free(pool_tcache* tc, void* ptr, pool_err* err);
+
+/**
+	@fn void pool_tcache_free_sized(pool_tcache* tc, void* ptr, pool_size size, pool_err* err)
+	@brief Frees a buffer of a known size, into the cache if possible
+
+	The order comes from the size, a cache hit touches only the cache. size is only checked
+	against the block when POOL_DEBUG is defined.
+
+	@param[inout] tc The thread cache
+	@param[in] ptr The buffer to free (may come from another thread's cache)
+	@param[in] size The size given to malloc
+	@param[out] err The error that happened
+*/
+POOL_FUNC void pool_tcache_free_sized(pool_tcache* tc, void* ptr, pool_size size, pool_err* err);
+
+/**
+	@fn void pool_tcache_flush(pool_tcache* tc, pool_err* err)
+	@brief Gives all the cached blocks back to the shared pool
+
+	@param[inout] tc The thread cache
+	@param[out] err The error that happened
+*/
+POOL_FUNC void pool_tcache_flush(pool_tcache* tc, pool_err* err);
+
+/**
+	@fn void pool_tcache_exit(void* tc)
+	@brief Flushes a thread cache when its thread exits
+
+	Has the signature of a thread-specific storage destructor (pthread_key_create, tss_create, FlsAlloc).
+
+	@param[inout] tc The thread cache
+*/
+POOL_FUNC void pool_tcache_exit(void* tc);
+
+/**
+	@fn void pool_tcache_stat(pool_tcache* tc, pool_tcache_stats* stats, pool_err* err)
+	@brief Stats the thread cache
+
+	@param[in] tc The thread cache
+	@param[out] stats The statistics
+	@param[out] err The error that happened
+*/
+POOL_FUNC void pool_tcache_stat(pool_tcache* tc, pool_tcache_stats* stats, pool_err* err);
+
+/** @} */
+
+#endif
@@ -0,0 +1,128 @@
+#include "pool_trace.h"
+
+/** The ring of the calling thread */
+static POOL_THREAD_LOCAL pool_trace* pool_trace_ring = NULL;
+
+/**
+	@fn void pool_trace_init(pool_trace* t, pool_trace_event* events, pool_u n, pool_u32 id, pool_err* err)
+	@brief Initializes a ring
+
+	@param[out] t The ring
+	@param[in] events The storage of the events
+	@param[in] n The number of events (power of 2)
+	@param[in] id Identifier written in the trace file
+	@param[out] err The error that happened
+*/
+POOL_FUNC void pool_trace_init(pool_trace* t, pool_trace_event* events, pool_u n, pool_u32 id, pool_err* err)
+{
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(t == NULL || events == NULL, err, POOL_ERR_INVALID_PTR, );
+	POOL_SET_ERR_IF(!POOL_IS_POW2(n), err, POOL_ERR_INVALID_SIZE, );
+	t->events = events;
+	t->mask = n - 1;
+	t->n = 0;
+	t->id = id;
+}
+
+/**
+	@fn void pool_trace_attach(pool_trace* t)
+	@brief Makes the calling thread record its operations in a ring
+
+	@param[in] t The ring (NULL to stop recording)
+*/
+POOL_FUNC void pool_trace_attach(pool_trace* t)
+{
+	pool_trace_ring = t;
+}
+
+/**
+	@fn pool_trace* pool_trace_current(void)
+	@brief Gets the ring of the calling thread
+
+	@return The ring, NULL if none
+*/
+POOL_FUNC pool_trace* pool_trace_current(void)
+{
+	return pool_trace_ring;
+}
+
+/**
+	@fn pool_trace_event* pool_trace_next(void)
+	@brief Takes the next event of the ring of the calling thread, to be filled by the caller
+
+	@return The event, NULL if the thread has no ring
+*/
+POOL_FUNC pool_trace_event* pool_trace_next(void)
+{
+	pool_trace* t = pool_trace_ring;
+	if (t == NULL)
+		return NULL;
+	return t->events + (t->n++ & t->mask);
+}
+
+/**
+	@fn static pool_u8* put_le(pool_u8* buf, pool_u64 val, pool_u n)
+	@brief Writes the n low bytes of a value in little endian
+
+	@param[out] buf The buffer
+	@param[in] val The value
+	@param[in] n The number of bytes
+
+	@return The end of the written bytes
+*/
+POOL_FUNC static pool_u8* put_le(pool_u8* buf, pool_u64 val, pool_u n)
+{
+	pool_u i;
+	for (i = 0; i < n; i++)
+		buf[i] = (pool_u8)(val >> (8 * i));
+	return buf + n;
+}
+
+/**
+	@fn void pool_trace_dump(pool_trace* t, pool_trace_writer write, void* data, pool_err* err)
+	@brief Writes a ring as a trace file, the oldest event first
+
+	The file is a header (magic, version, event size, id, number of events in the file, number of overwritten events)
+	followed by the events, every field in little endian.
+
+	@param[in] t The ring
+	@param[in] write Writes the bytes of the file
+	@param[in] data The data passed to write
+	@param[out] err The error that happened (POOL_ERR_IO if write failed)
+*/
+POOL_FUNC void pool_trace_dump(pool_trace* t, pool_trace_writer write, void* data, pool_err* err)
+{
+	pool_u8 buf[POOL_TRACE_HEADER_SIZE > POOL_TRACE_EVENT_SIZE ? POOL_TRACE_HEADER_SIZE : POOL_TRACE_EVENT_SIZE];
+	pool_u8* at;
+	pool_u64 i, first, count;
+	const pool_trace_event* e;
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(t == NULL || write == NULL, err, POOL_ERR_INVALID_PTR, );
+	count = t->n <= (pool_u64)t->mask + 1 ? t->n : (pool_u64)t->mask + 1;
+	first = t->n - count;
+
+	at = put_le(buf, POOL_TRACE_MAGIC, 4);
+	at = put_le(at, POOL_TRACE_VERSION, 2);
+	at = put_le(at, POOL_TRACE_EVENT_SIZE, 2);
+	at = put_le(at, t->id, 4);
+	at = put_le(at, 0, 4);
+	at = put_le(at, count, 8);
+	put_le(at, first, 8);
+	POOL_SET_ERR_IF(!write(data, buf, POOL_TRACE_HEADER_SIZE), err, POOL_ERR_IO, );
+
+	for (i = first; i < t->n; i++)
+	{
+		e = t->events + (i & t->mask);
+		at = put_le(buf, e->time, 8);
+		at = put_le(at, e->ptr, 8);
+		at = put_le(at, e->size, 8);
+		at = put_le(at, e->cycles, 4);
+		at = put_le(at, e->page, 4);
+		at = put_le(at, e->kind, 1);
+		at = put_le(at, e->order, 1);
+		at = put_le(at, e->err, 1);
+		at = put_le(at, e->retries, 1);
+		put_le(at, 0, 4);
+		POOL_SET_ERR_IF(!write(data, buf, POOL_TRACE_EVENT_SIZE), err, POOL_ERR_IO, );
+	}
+}
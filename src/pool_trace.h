@@ -0,0 +1,171 @@
+/** @file */
+#ifndef POOL_TRACE_H_INCLUDED
+#define POOL_TRACE_H_INCLUDED
+
+#include "pool_defs.h"
+
+/**
+@defgroup TRACE Allocation tracing
+When POOL_TRACE is defined, the slab pool records every malloc, realloc and free (and their failures)
+in the ring of the calling thread. Each thread writes only its own ring, so recording takes no lock
+and no atomic operation. A ring is dumped by its thread, or once its thread stopped allocating.
+@{
+*/
+
+/** Thread local storage class */
+#if defined(_MSC_VER)
+#define POOL_THREAD_LOCAL __declspec(thread)
+#else
+#define POOL_THREAD_LOCAL __thread
+#endif
+
+/** Reads the cycle counter (define it to use another clock, 0 when there is none) */
+#ifndef POOL_TRACE_CLOCK
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define POOL_TRACE_CLOCK() ((pool_u64)__builtin_ia32_rdtsc())
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define POOL_TRACE_CLOCK() ((pool_u64)__rdtsc())
+#elif defined(__GNUC__) && defined(__aarch64__)
+#define POOL_TRACE_CLOCK() pool_trace_clock()
+#else
+#define POOL_TRACE_CLOCK() ((pool_u64)0)
+#endif
+#endif
+
+/** Magic number at the start of a trace file ("MMTR" in little endian) */
+#define POOL_TRACE_MAGIC 0x52544d4d
+/** Version of the trace file format */
+#define POOL_TRACE_VERSION 1
+/** Size of the trace file header */
+#define POOL_TRACE_HEADER_SIZE 32
+/** Size of an event in a trace file */
+#define POOL_TRACE_EVENT_SIZE 40
+
+/**
+	@enum _pool_trace_kind
+	@brief The traced operations
+*/
+typedef enum _pool_trace_kind
+{
+	/** pool_slab_malloc, pool_slab_memalign or a buffer of pool_slab_malloc_batch */
+	POOL_TRACE_MALLOC = 0,
+	/** pool_slab_free, pool_slab_free_sized or a buffer of pool_slab_free_batch */
+	POOL_TRACE_FREE = 1,
+	/** pool_slab_realloc (a FREE of the old buffer with the same time follows it when the buffer moved, a size of 0 is only a FREE) */
+	POOL_TRACE_REALLOC = 2
+} pool_trace_kind;
+
+/**
+	@struct _pool_trace_event
+	@brief A traced operation
+*/
+typedef struct _pool_trace_event
+{
+	/** Clock at the start of the operation */
+	pool_u64 time;
+	/** The returned or freed buffer (0 on failure) */
+	pool_u64 ptr;
+	/** The requested size, the freed size for a free */
+	pool_u64 size;
+	/** Clock ticks spent in the operation */
+	pool_u32 cycles;
+	/** The page of the buffer (the page count of the pool if none) */
+	pool_u32 page;
+	/** The operation (pool_trace_kind) */
+	pool_u8 kind;
+	/** The buddy order of the buffer (POOL_BUDDY_ORDER_NONE for a RAW buffer) */
+	pool_u8 order;
+	/** The error of the operation */
+	pool_err err;
+	/** Number of pages that changed before they were locked and were skipped */
+	pool_u8 retries;
+} pool_trace_event;
+
+/**
+	@struct _pool_trace
+	@brief The ring of events of a thread
+*/
+typedef struct _pool_trace
+{
+	/** The events (a power of 2) */
+	pool_trace_event* events;
+	/** Number of events minus 1 */
+	pool_u mask;
+	/** Number of events recorded since init, the oldest ones are overwritten */
+	pool_u64 n;
+	/** Identifier written in the trace file (the thread) */
+	pool_u32 id;
+} pool_trace;
+
+/** Writes n bytes of a trace file, returns 0 on failure */
+typedef pool_u8 (*pool_trace_writer)(void* data, const void* buf, pool_size n);
+
+/**
+	@fn void pool_trace_init(pool_trace* t, pool_trace_event* events, pool_u n, pool_u32 id, pool_err* err)
+	@brief Initializes a ring
+
+	@param[out] t The ring
+	@param[in] events The storage of the events
+	@param[in] n The number of events (power of 2)
+	@param[in] id Identifier written in the trace file
+	@param[out] err The error that happened
+*/
+POOL_FUNC void pool_trace_init(pool_trace* t, pool_trace_event* events, pool_u n, pool_u32 id, pool_err* err);
+
+/**
+	@fn void pool_trace_attach(pool_trace* t)
+	@brief Makes the calling thread record its operations in a ring
+
+	@param[in] t The ring (NULL to stop recording)
+*/
+POOL_FUNC void pool_trace_attach(pool_trace* t);
+
+/**
+	@fn pool_trace* pool_trace_current(void)
+	@brief Gets the ring of the calling thread
+
+	@return The ring, NULL if none
+*/
+POOL_FUNC pool_trace* pool_trace_current(void);
+
+/**
+	@fn pool_trace_event* pool_trace_next(void)
+	@brief Takes the next event of the ring of the calling thread, to be filled by the caller
+
+	@return The event, NULL if the thread has no ring
+*/
+POOL_FUNC pool_trace_event* pool_trace_next(void);
+
+/**
+	@fn void pool_trace_dump(pool_trace* t, pool_trace_writer write, void* data, pool_err* err)
+	@brief Writes a ring as a trace file, the oldest event first
+
+	The file is a header (magic, version, event size, id, number of events in the file, number of overwritten events)
+	followed by the events, every field in little endian.
+
+	@param[in] t The ring
+	@param[in] write Writes the bytes of the file
+	@param[in] data The data passed to write
+	@param[out] err The error that happened (POOL_ERR_IO if write failed)
+*/
+POOL_FUNC void pool_trace_dump(pool_trace* t, pool_trace_writer write, void* data, pool_err* err);
+
+#if defined(__GNUC__) && defined(__aarch64__)
+/**
+	@fn pool_u64 pool_trace_clock(void)
+	@brief Reads the virtual counter
+
+	@return The counter
+*/
+static inline pool_u64 pool_trace_clock(void)
+{
+	pool_u64 t;
+	__asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(t));
+	return t;
+}
+#endif
+
+/** @} */
+
+#endif
@@ -0,0 +1,346 @@
+#include "ulist.h"
+
+/** Number of items under which a chunk is merged with a neighbour */
+#define SPARSE_N (POOL_ULIST_CHUNK_N / 2)
+/** Maximum number of items of a merged chunk, leaves room for inserts */
+#define MERGE_N (POOL_ULIST_CHUNK_N * 3 / 4)
+
+/**
+	@fn static pool_ulist_chunk* find_chunk(pool_ulist* list, pool_size at, pool_u* i)
+	@brief Finds the chunk of an index, from the closest end of the list
+
+	@param[in] list The list
+	@param[in] at The index
+	@param[out] i The index in the chunk
+
+	@return The chunk
+*/
+POOL_FUNC static pool_ulist_chunk* find_chunk(pool_ulist* list, pool_size at, pool_u* i)
+{
+	pool_ulist_chunk* c;
+	pool_size back;
+	if (at <= list->size / 2)
+	{
+		c = list->head;
+		while (c->next != NULL && at >= c->count)
+		{
+			at -= c->count;
+			c = c->next;
+		}
+		*i = at;
+	}
+	else
+	{
+		c = list->tail;
+		back = list->size - at;
+		while (back > c->count)
+		{
+			back -= c->count;
+			c = c->prev;
+		}
+		*i = c->count - back;
+	}
+	return c;
+}
+
+/**
+	@fn static pool_ulist_chunk* chunk_new(pool_ulist* list, pool_ulist_chunk* prev, pool_err* err)
+	@brief Allocates an empty chunk and links it
+
+	@param[inout] list The list
+	@param[in] prev The chunk before the new one, NULL for the beginning of the list
+	@param[out] err The error
+
+	@return The new chunk
+*/
+POOL_FUNC static pool_ulist_chunk* chunk_new(pool_ulist* list, pool_ulist_chunk* prev, pool_err* err)
+{
+	pool_ulist_chunk* c = pool_malloc(list->pool, sizeof(pool_ulist_chunk), err);
+	if (c == NULL)
+		return NULL;
+	c->count = 0;
+	c->prev = prev;
+	c->next = prev != NULL ? prev->next : list->head;
+	if (c->prev != NULL)
+		c->prev->next = c;
+	else
+		list->head = c;
+	if (c->next != NULL)
+		c->next->prev = c;
+	else
+		list->tail = c;
+	return c;
+}
+
+/**
+	@fn static void chunk_free(pool_ulist* list, pool_ulist_chunk* c)
+	@brief Unlinks and frees a chunk
+
+	@param[inout] list The list
+	@param[in] c The chunk
+*/
+POOL_FUNC static void chunk_free(pool_ulist* list, pool_ulist_chunk* c)
+{
+	if (c->prev != NULL)
+		c->prev->next = c->next;
+	else
+		list->head = c->next;
+	if (c->next != NULL)
+		c->next->prev = c->prev;
+	else
+		list->tail = c->prev;
+	pool_free(list->pool, c, NULL);
+}
+
+/**
+	@fn static void chunk_merge(pool_ulist* list, pool_ulist_chunk* c)
+	@brief Moves the items of the next chunk at the end of a chunk and frees the next chunk
+
+	@param[inout] list The list
+	@param[inout] c The chunk
+*/
+POOL_FUNC static void chunk_merge(pool_ulist* list, pool_ulist_chunk* c)
+{
+	pool_ulist_chunk* n = c->next;
+	pool_u i;
+	for (i = 0; i < n->count; i++)
+		c->data[c->count + i] = n->data[i];
+	c->count += n->count;
+	chunk_free(list, n);
+}
+
+/**
+	@fn void pool_ulist_init(pool_ulist* list, pool_t* pool, pool_err* err)
+	@brief Initializes the list
+
+	@param[inout] list The list
+	@param[in] pool The memory pool
+	@param[out] err The error
+*/
+POOL_FUNC void pool_ulist_init(pool_ulist* list, pool_t* pool, pool_err* err)
+{
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(list == NULL, err, POOL_LIST_ERR_INVALID_LIST, );
+	POOL_SET_ERR_IF(pool == NULL, err, POOL_LIST_ERR_INVALID_POOL, );
+
+	list->pool = pool;
+	list->head = NULL;
+	list->tail = NULL;
+	list->size = 0;
+}
+
+/**
+	@fn void pool_ulist_insert(pool_ulist* list, void* data, pool_size at, pool_err* err)
+	@brief Inserts an item, a full chunk is split in two
+
+	@param[inout] list The list
+	@param[in] data The data to add
+	@param[in] at The index of the new item (the size of the list for the end)
+	@param[out] err The error
+*/
+POOL_FUNC void pool_ulist_insert(pool_ulist* list, void* data, pool_size at, pool_err* err)
+{
+	pool_ulist_chunk* c;
+	pool_ulist_chunk* n;
+	pool_u i, j;
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(list == NULL || list->pool == NULL, err, POOL_LIST_ERR_INVALID_LIST, );
+	POOL_SET_ERR_IF(at > list->size, err, POOL_LIST_ERR_INVALID_NODE, );
+
+	if (list->head == NULL)
+	{
+		c = chunk_new(list, NULL, err);
+		if (c == NULL)
+			return;
+		i = 0;
+	}
+	else
+		c = find_chunk(list, at, &i);
+	if (c->count == POOL_ULIST_CHUNK_N)
+	{
+		// At an end of the chunk, the neighbour or a new chunk takes the item
+		if (i == POOL_ULIST_CHUNK_N)
+		{
+			if (c->next == NULL || c->next->count == POOL_ULIST_CHUNK_N)
+				c = chunk_new(list, c, err);
+			else
+				c = c->next;
+			i = 0;
+		}
+		else if (i == 0)
+		{
+			if (c->prev == NULL || c->prev->count == POOL_ULIST_CHUNK_N)
+				c = chunk_new(list, c->prev, err);
+			else
+				c = c->prev;
+			if (c != NULL)
+				i = c->count;
+		}
+		// In the middle, the upper half moves to a new chunk
+		else
+		{
+			n = chunk_new(list, c, err);
+			if (n == NULL)
+				return;
+			n->count = POOL_ULIST_CHUNK_N / 2;
+			c->count -= n->count;
+			for (j = 0; j < n->count; j++)
+				n->data[j] = c->data[c->count + j];
+			if (i > c->count)
+			{
+				i -= c->count;
+				c = n;
+			}
+		}
+		if (c == NULL)
+			return;
+	}
+	for (j = c->count; j > i; j--)
+		c->data[j] = c->data[j - 1];
+	c->data[i] = data;
+	c->count++;
+	list->size++;
+}
+
+/**
+	@fn void pool_ulist_push_back(pool_ulist* list, void* data, pool_err* err)
+	@brief Adds an item to the end of the list
+
+	@param[inout] list The list
+	@param[in] data The data to add
+	@param[out] err The error
+*/
+POOL_FUNC void pool_ulist_push_back(pool_ulist* list, void* data, pool_err* err)
+{
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(list == NULL, err, POOL_LIST_ERR_INVALID_LIST, );
+	pool_ulist_insert(list, data, list->size, err);
+}
+
+/**
+	@fn void pool_ulist_push_front(pool_ulist* list, void* data, pool_err* err)
+	@brief Adds an item to the beginning of the list
+
+	@param[inout] list The list
+	@param[in] data The data to add
+	@param[out] err The error
+*/
+POOL_FUNC void pool_ulist_push_front(pool_ulist* list, void* data, pool_err* err)
+{
+	pool_ulist_insert(list, data, 0, err);
+}
+
+/**
+	@fn void* pool_ulist_get(pool_ulist* list, pool_size at, pool_err* err)
+	@brief Gets an item
+
+	@param[in] list The list
+	@param[in] at The index of the item
+	@param[out] err The error
+
+	@return The item
+*/
+POOL_FUNC void* pool_ulist_get(pool_ulist* list, pool_size at, pool_err* err)
+{
+	pool_ulist_chunk* c;
+	pool_u i;
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(list == NULL, err, POOL_LIST_ERR_INVALID_LIST, NULL);
+	POOL_SET_ERR_IF(at >= list->size, err, POOL_LIST_ERR_INVALID_NODE, NULL);
+	c = find_chunk(list, at, &i);
+	return c->data[i];
+}
+
+/**
+	@fn void* pool_ulist_remove(pool_ulist* list, pool_size at, pool_err* err)
+	@brief Removes an item, a sparse chunk is merged with a neighbour
+
+	@param[inout] list The list
+	@param[in] at The index of the item
+	@param[out] err The error
+
+	@return The removed item
+*/
+POOL_FUNC void* pool_ulist_remove(pool_ulist* list, pool_size at, pool_err* err)
+{
+	pool_ulist_chunk* c;
+	pool_u i;
+	void* ret;
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(list == NULL || list->pool == NULL, err, POOL_LIST_ERR_INVALID_LIST, NULL);
+	POOL_SET_ERR_IF(at >= list->size, err, POOL_LIST_ERR_INVALID_NODE, NULL);
+
+	c = find_chunk(list, at, &i);
+	ret = c->data[i];
+	c->count--;
+	for (; i < c->count; i++)
+		c->data[i] = c->data[i + 1];
+	list->size--;
+
+	if (c->count == 0)
+		chunk_free(list, c);
+	else if (c->count < SPARSE_N)
+	{
+		if (c->next != NULL && c->count + c->next->count <= MERGE_N)
+			chunk_merge(list, c);
+		else if (c->prev != NULL && c->prev->count + c->count <= MERGE_N)
+			chunk_merge(list, c->prev);
+	}
+	return ret;
+}
+
+/**
+	@fn void pool_ulist_delete(pool_ulist* list, pool_err* err)
+	@brief Removes all items from the list
+
+	@param[inout] list The list
+	@param[out] err The error
+*/
+POOL_FUNC void pool_ulist_delete(pool_ulist* list, pool_err* err)
+{
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(list == NULL || list->pool == NULL, err, POOL_LIST_ERR_INVALID_LIST, );
+	while (list->head != NULL)
+		chunk_free(list, list->head);
+	list->size = 0;
+}
+
+/**
+	@fn void pool_ulist_iterate(pool_ulist* list, pool_ulist_iterate_func func, void* data, pool_err* err)
+	@brief Iterates over all the list's items
+
+	@param[inout] list The list
+	@param[in] func The callback function, the function should return 1 to continue and 0 to stop
+	@param[in] data The data to pass to the function
+	@param[out] err The error
+*/
+POOL_FUNC void pool_ulist_iterate(pool_ulist* list, pool_ulist_iterate_func func, void* data, pool_err* err)
+{
+	pool_ulist_chunk* c;
+	pool_u i;
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(list == NULL, err, POOL_LIST_ERR_INVALID_LIST, );
+	POOL_SET_ERR_IF(func == NULL, err, POOL_LIST_ERR_INVALID_FUNC, );
+	for (c = list->head; c != NULL; c = c->next)
+	{
+		for (i = 0; i < c->count; i++)
+		{
+			if (!func(c->data[i], data))
+				return;
+		}
+	}
+}
+
+/**
+	@fn pool_size pool_ulist_size(pool_ulist* list, pool_err* err)
+	@brief Gets the size of the list
+
+	@param[in] list The list
+	@param[out] err The error
+*/
+POOL_FUNC pool_size pool_ulist_size(pool_ulist* list, pool_err* err)
+{
+	POOL_SET_ERR(err, POOL_ERR_OK);
+	POOL_SET_ERR_IF(list == NULL, err, POOL_LIST_ERR_INVALID_LIST, 0);
+	return list->size;
+}
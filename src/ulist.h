@@ -0,0 +1,150 @@
+/** @file */
+#ifndef ULIST_H_INCLUDED
+#define ULIST_H_INCLUDED
+
+#include "list.h"
+
+/**
+	@defgroup ULIST Unrolled list
+	A doubly linked list of chunks, each chunk holds several items in an array
+	@{
+*/
+
+/** Size of a chunk, it should be a block size of the pool */
+#ifndef POOL_ULIST_CHUNK_SIZE
+#define POOL_ULIST_CHUNK_SIZE 128
+#endif
+
+/** Number of items in a chunk */
+#define POOL_ULIST_CHUNK_N ((POOL_ULIST_CHUNK_SIZE - 2 * sizeof(void*) - sizeof(pool_u)) / sizeof(void*))
+
+/**
+	@struct _pool_ulist_chunk
+	@brief A chunk of items
+*/
+typedef struct _pool_ulist_chunk
+{
+	/** The next chunk (NULL if none) */
+	struct _pool_ulist_chunk* next;
+	/** The previous chunk (NULL if none) */
+	struct _pool_ulist_chunk* prev;
+	/** The number of items in the chunk */
+	pool_u count;
+	/** The items, the first count are used */
+	void* data[POOL_ULIST_CHUNK_N];
+} pool_ulist_chunk;
+
+/**
+	@struct _pool_ulist
+	@brief An unrolled list
+*/
+typedef struct _pool_ulist
+{
+	/** The pool used by the list */
+	pool_t* pool;
+	/** The first chunk */
+	pool_ulist_chunk* head;
+	/** The last chunk */
+	pool_ulist_chunk* tail;
+	/** The number of items */
+	pool_size size;
+} pool_ulist;
+
+/** Callback function for iterate, gets the item and the user data */
+typedef pool_u8 (*pool_ulist_iterate_func)(void*, void*);
+
+/**
+	@fn void pool_ulist_init(pool_ulist* list, pool_t* pool, pool_err* err)
+	@brief Initializes the list
+
+	@param[inout] list The list
+	@param[in] pool The memory pool
+	@param[out] err The error
+*/
+POOL_FUNC void pool_ulist_init(pool_ulist* list, pool_t* pool, pool_err* err);
+
+/**
+	@fn void pool_ulist_insert(pool_ulist* list, void* data, pool_size at, pool_err* err)
+	@brief Inserts an item, a full chunk is split in two
+
+	@param[inout] list The list
+	@param[in] data The data to add
+	@param[in] at The index of the new item (the size of the list for the end)
+	@param[out] err The error
+*/
+POOL_FUNC void pool_ulist_insert(pool_ulist* list, void* data, pool_size at, pool_err* err);
+
+/**
+	@fn void pool_ulist_push_back(pool_ulist* list, void* data, pool_err* err)
+	@brief Adds an item to the end of the list
+
+	@param[inout] list The list
+	@param[in] data The data to add
+	@param[out] err The error
+*/
+POOL_FUNC void pool_ulist_push_back(pool_ulist* list, void* data, pool_err* err);
+
+/**
+	@fn void pool_ulist_push_front(pool_ulist* list, void* data, pool_err* err)
+	@brief Adds an item to the beginning of the list
+
+	@param[inout] list The list
+	@param[in] data The data to add
+	@param[out] err The error
+*/
+POOL_FUNC void pool_ulist_push_front(pool_ulist* list, void* data, pool_err* err);
+
+/**
+	@fn void* pool_ulist_get(pool_ulist* list, pool_size at, pool_err* err)
+	@brief Gets an item
+
+	@param[in] list The list
+	@param[in] at The index of the item
+	@param[out] err The error
+
+	@return The item
+*/
+POOL_FUNC void* pool_ulist_get(pool_ulist* list, pool_size at, pool_err* err);
+
+/**
+	@fn void* pool_ulist_remove(pool_ulist* list, pool_size at, pool_err* err)
+	@brief Removes an item, a sparse chunk is merged with a neighbour
+
+	@param[inout] list The list
+	@param[in] at The index of the item
+	@param[out] err The error
+
+	@return The removed item
+*/
+POOL_FUNC void* pool_ulist_remove(pool_ulist* list, pool_size at, pool_err* err);
+
+/**
+	@fn void pool_ulist_delete(pool_ulist* list, pool_err* err)
+	@brief Removes all items from the list
+
+	@param[inout] list The list
+	@param[out] err The error
+*/
+POOL_FUNC void pool_ulist_delete(pool_ulist* list, pool_err* err);
+
+/**
+	@fn void pool_ulist_iterate(pool_ulist* list, pool_ulist_iterate_func func, void* data, pool_err* err)
+	@brief Iterates over all the list's items
+
+	@param[inout] list The list
+	@param[in] func The callback function, the function should return 1 to continue and 0 to stop
+	@param[in] data The data to pass to the function
+	@param[out] err The error
+*/
+POOL_FUNC void pool_ulist_iterate(pool_ulist* list, pool_ulist_iterate_func func, void* data, pool_err* err);
+
+/**
+	@fn pool_size pool_ulist_size(pool_ulist* list, pool_err* err)
+	@brief Gets the size of the list
+
+	@param[in] list The list
+	@param[out] err The error
+*/
+POOL_FUNC pool_size pool_ulist_size(pool_ulist* list, pool_err* err);
+/** @} */
+#endif